@@ -0,0 +1,66 @@
+#ifndef ARG_PARSER_HPP
+#define ARG_PARSER_HPP
+
+#include <charconv>     // std::from_chars
+#include <cmath>        // std::isnan
+#include <cstdint>
+#include <string_view>
+#include <system_error> // std::errc
+#include <vector>
+
+// Numeric command arguments (ZADD scores, PEXPIRE TTLs, vector components) parsed straight from the request's
+// string_views with std::from_chars: no std::string copy, no locale, no exceptions on bad input - a malformed
+// argument is just false. libstdc++'s floating point from_chars is the Eisel-Lemire fast path with exact rounding.
+//
+// Accepted: what from_chars takes for decimal numbers, plus an optional leading '+' (stod/stoll took one, and
+// so do clients that print "+inf"). The whole argument has to be the number, trailing bytes fail the parse.
+class ArgParser {
+public:
+    static bool parse_int(std::string_view arg, int64_t& out) noexcept {
+        return parse(skip_plus(arg), out);
+    }
+
+    // NaN is rejected, +-inf are allowed (open-ended score ranges)
+    static bool parse_double(std::string_view arg, double& out) noexcept {
+        return parse(skip_plus(arg), out) && !std::isnan(out);
+    }
+
+    static bool parse_float(std::string_view arg, float& out) noexcept {
+        return parse(skip_plus(arg), out) && !std::isnan(out);
+    }
+
+    // a vector argument: components separated by commas, "0.12,-3.5,1e-3". Appends to out, which is left as it was
+    // if any component is malformed.
+    static bool parse_float_array(std::string_view arg, std::vector<float>& out) {
+        size_t old_size = out.size();
+        while (true) {
+            size_t comma = arg.find(',');
+            float value;
+            if (!parse_float(arg.substr(0, comma), value)) {
+                out.resize(old_size);
+                return false;
+            }
+            out.push_back(value);
+            if (comma == std::string_view::npos) {
+                return true;
+            }
+            arg.remove_prefix(comma + 1);
+        }
+    }
+
+private:
+    static std::string_view skip_plus(std::string_view arg) noexcept {
+        if (arg.size() > 1 && arg[0] == '+' && arg[1] != '-') {
+            arg.remove_prefix(1);
+        }
+        return arg;
+    }
+
+    template<typename T>
+    static bool parse(std::string_view arg, T& out) noexcept {
+        auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), out);
+        return ec == std::errc() && end == arg.data() + arg.size();
+    }
+};
+
+#endif // ARG_PARSER_HPP
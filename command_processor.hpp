@@ -4,239 +4,430 @@
 #include <vector>
 #include <string>
 #include <string_view>
-#include <unordered_map>
-#include <functional>
+#include <array>
+#include <bit>
 #include <chrono>        // std::chrono::steady_clock
 #include <cstdint>       // std::uint64_t
 #include <algorithm>
+#include <cmath>         // std::isnan
 #include <utility>
+#include <span>
 #include <mutex>        
 #include "src/hashtable.hpp"
 #include "src/heap.hpp"
 #include "src/zset.hpp"
 #include "entry_manager.hpp"
 #include "response_serializer.hpp"
+#include "request_parser.hpp"
+#include "arg_parser.hpp"
 
 constexpr int ERR_ARG = -1;
 constexpr int ERR_UNKNOWN = -2;
 constexpr int ERR_TYPE = -3;
+constexpr int ERR_OOM = -4;
 
 // modern command processor with type-safe command handling
 
 class CommandProcessor {
 public:
+    // args are views into the connection's read buffer, handlers copy only what they store
+    // streamed is set when the last argument was received into its own buffer (see Connection::body_),
+    // a handler that stores that argument may move from it instead of copying the view.
+    // refs, when set, collects large values the reply references rather than copies (see ValueRef).
+    // format is the connection's reply format, HELLO stores a newly negotiated one in session_format.
     struct CommandContext {
-        const std::vector<std::string>& args;
+        const CommandArgs& args;
         std::vector<uint8_t>& response;
         EntryManager& entry_manager;
+        std::string* streamed = nullptr;
+        std::vector<ValueRef>* refs = nullptr;
+        ResponseFormat format = ResponseFormat::V1;
+        ResponseFormat* session_format = nullptr;
     };
 
-    static const std::unordered_map<std::string, std::function<void(CommandContext)>> command_handlers;
+    using HandlerFn = void (*)(const CommandContext&);
 
-    static void process_command(CommandContext ctx) {
+    // Which arguments are keys, i.e. which keyspace shards a command locks before it runs (see ShardLocks).
+    // Single is args[1], Each is args[1..], Pairs is args[1], args[3]... (MSET), All is every shard.
+    enum class KeySpan : uint8_t { None, Single, Each, Pairs, All };
+
+    // name is lowercase, matched case-insensitively against the request.
+    // writes = true takes the key's shards exclusively, read-only commands share them across reactors.
+    // slow = true goes to the thread pool in ExecutionMode::Hybrid, the cheap O(1) ones stay on the reactor.
+    struct CommandHandler {
+        std::string_view name;
+        HandlerFn handler;
+        KeySpan keys;
+        bool writes;
+        bool slow;
+    };
+
+    static constexpr size_t MAX_COMMAND_LEN = 16;
+    static constexpr size_t COMMAND_COUNT = 13;
+    static constexpr size_t DISPATCH_SLOTS = std::bit_ceil(COMMAND_COUNT * 2);
+
+    static const std::array<CommandHandler, COMMAND_COUNT> command_handlers;
+
+    // Slot table built at compile time (see find_dispatch_seed), so a lookup is one hash over the raw bytes, one load
+    // and one compare - no lowercased copy, no probing, no std::function.
+    static const uint32_t dispatch_seed;
+    static const std::array<const CommandHandler*, DISPATCH_SLOTS> dispatch_slots;
+
+    static void process_command(const CommandContext& ctx) {
         if (ctx.args.empty()) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "empty command\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "empty command\n", ctx.format);
         }
         
-        std::string command_key = ctx.args[0]; 
-        std::transform(command_key.begin(), command_key.end(), command_key.begin(), ::tolower);
+        const CommandHandler* handler = find_handler(ctx.args[0]);
+        if (!handler) { 
+            return ResponseSerializer::serialize_error(ctx.response, ERR_UNKNOWN, "unknown command\n", ctx.format);
+        }
+
+        // a wrong argument count still takes the locks, the handler replies with the error
+        std::span<const std::string_view> args(ctx.args.begin(), ctx.args.end());
+        switch (handler->keys) {
+            case KeySpan::None:
+                return handler->handler(ctx);
+            case KeySpan::All: {
+                auto locks = ctx.entry_manager.lock_all(handler->writes);
+                return handler->handler(ctx);
+            }
+            default: {
+                auto keys = args.size() < 2 ? args.subspan(0, 0)
+                            : handler->keys == KeySpan::Single ? args.subspan(1, 1) : args.subspan(1);
+                size_t step = handler->keys == KeySpan::Pairs ? 2 : 1;
+                auto locks = ctx.entry_manager.lock_keys(keys, step, handler->writes);
+                return handler->handler(ctx);
+            }
+        }
+    }
 
-        auto it = command_handlers.find(command_key);
-        if (it == command_handlers.end()) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_UNKNOWN, "unknown command\n");
+    // unknown and empty commands are just an error reply, not worth a trip to the pool
+    static bool is_slow(const CommandArgs& args) {
+        const CommandHandler* handler = args.empty() ? nullptr : find_handler(args[0]);
+        return handler && handler->slow;
+    }
+
+    // nullptr for unknown commands
+    static const CommandHandler* find_handler(std::string_view name) noexcept {
+        if (name.size() > MAX_COMMAND_LEN) {
+            return nullptr;
+        }
+        const CommandHandler* handler = dispatch_slots[dispatch_slot(name, dispatch_seed)];
+        return handler && name_equals(name, handler->name) ? handler : nullptr;
+    }
+
+    // FNV-1a over the name with ASCII letters folded to lowercase (c | 0x20), seeded so the compile-time
+    // search below can pick a seed that spreads the command names without collisions.
+    static constexpr uint32_t hash_name(std::string_view name, uint32_t seed) noexcept {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : name) {
+            h = (h ^ static_cast<uint8_t>(c | 0x20)) * 16777619u;
         }
+        return h;
+    }
 
-        it->second(ctx);
+    // Slot from the top bits: FNV's low bits only depend on the low bits of the seed and the bytes, so masking
+    // them would give the seed search just a few distinct layouts to try.
+    static constexpr size_t dispatch_slot(std::string_view name, uint32_t seed) noexcept {
+        return hash_name(name, seed) >> (32 - std::countr_zero(DISPATCH_SLOTS));
+    }
+
+    // The names are all lowercase letters, so folding the input with | 0x20 only ever turns an uppercase letter
+    // into its lowercase one; any other byte folds to something that can't match.
+    static constexpr bool name_equals(std::string_view input, std::string_view name) noexcept {
+        if (input.size() != name.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < name.size(); ++i) {
+            if (static_cast<char>(input[i] | 0x20) != name[i]) {
+                return false;
+            }
+        }
+        return true;
     }
 
 private:
-    static void handle_get(CommandContext ctx) {
+    // tries seeds until every command name hashes to its own slot, 0 if none does (or a name breaks name_equals)
+    static constexpr uint32_t find_dispatch_seed() {
+        if (!valid_command_names()) {
+            return 0;
+        }
+        for (uint32_t seed = 1; seed < (1u << 16); ++seed) {
+            std::array<bool, DISPATCH_SLOTS> used{};
+            bool collided = false;
+            for (const auto& command : command_handlers) {
+                size_t slot = dispatch_slot(command.name, seed);
+                collided |= used[slot];
+                used[slot] = true;
+            }
+            if (!collided) {
+                return seed;
+            }
+        }
+        return 0;
+    }
+
+    static constexpr std::array<const CommandHandler*, DISPATCH_SLOTS> build_dispatch_slots(uint32_t seed) {
+        std::array<const CommandHandler*, DISPATCH_SLOTS> slots{};
+        for (const auto& command : command_handlers) {
+            slots[dispatch_slot(command.name, seed)] = &command;
+        }
+        return slots;
+    }
+
+    static constexpr bool valid_command_names() {
+        for (const auto& command : command_handlers) {
+            if (command.name.empty() || command.name.size() > MAX_COMMAND_LEN) return false;
+            for (char c : command.name) {
+                if (c < 'a' || c > 'z') return false;
+            }
+        }
+        return true;
+    }
+
+    static void handle_get(const CommandContext& ctx) {
         if (ctx.args.size() != 2) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "GET requires one key\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "GET requires one key\n", ctx.format);
         }
 
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        if (!entry) { 
+        Value* value = ctx.entry_manager.find_entry(ctx.args[1]);
+        if (!value) { 
             return ResponseSerializer::serialize_nil(ctx.response);
         }
 
-        if (auto str_entry = std::dynamic_pointer_cast<Entry<std::string>>(entry)) {
-            ResponseSerializer::serialize_string(ctx.response, str_entry->value);
+        if (value->is_string()) {
+            serialize_value(ctx, *value);
         } else {
-            ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n");
+            ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n", ctx.format);
+        }
+    }
+
+    // a stored string as a bulk reply. Only a Raw value can be big enough to go by reference (and pin its string),
+    // the small encodings are copied straight out of the Value
+    static void serialize_value(const CommandContext& ctx, const Value& value) {
+        if (value.encoding() == ValueEncoding::Raw) {
+            return ResponseSerializer::serialize_bulk_ref(ctx.response, ctx.refs, value.raw_string(), *value.raw_string(), ctx.format);
         }
+        char scratch[Value::INT_DIGITS_MAX];
+        ResponseSerializer::serialize_bulk(ctx.response, value.str(scratch), ctx.format);
     }
 
-    static void handle_set(CommandContext ctx) {
+    static void handle_set(const CommandContext& ctx) {
         if (ctx.args.size() != 3) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "SET requires key and value\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "SET requires key and value\n", ctx.format);
         }
     
-        ctx.entry_manager.create_entry(ctx.args[1], ctx.args[2]);
-        ResponseSerializer::serialize_string(ctx.response, "OK");
+        if (!ctx.entry_manager.make_room(ctx.args[1])) {
+            return serialize_oom(ctx);
+        }
+        Value value = ctx.streamed ? Value::string(std::move(*ctx.streamed)) : Value::string(ctx.args[2]);
+        ctx.entry_manager.create_entry(std::string(ctx.args[1]), std::move(value));
+        ResponseSerializer::serialize_string(ctx.response, "OK", ctx.format);
     }    
 
-    static void handle_del(CommandContext ctx) {
+    // a write that would add data while over max_memory and nothing could be evicted (see EntryManager::make_room)
+    static void serialize_oom(const CommandContext& ctx) {
+        ResponseSerializer::serialize_error(ctx.response, ERR_OOM, "OOM command not allowed when used memory > max memory\n", ctx.format);
+    }
+
+    static void handle_del(const CommandContext& ctx) {
         if (ctx.args.size() != 2) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "DEL requires key\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "DEL requires key\n", ctx.format);
         }
     
         bool deleted = ctx.entry_manager.delete_entry(ctx.args[1]);
-        ResponseSerializer::serialize_integer(ctx.response, deleted ? 1 : 0);
+        ResponseSerializer::serialize_integer(ctx.response, deleted ? 1 : 0, ctx.format);
     }
     
-    static void handle_exists(CommandContext ctx) {
+    // MGET/MSET/MDEL go to the map as one batch (EntryManager::find_entries etc.), not one lookup per key
+    static void handle_mget(const CommandContext& ctx) {
+        if (ctx.args.size() < 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "MGET requires at least one key\n", ctx.format);
+        }
+
+        auto values = ctx.entry_manager.find_entries(std::span(ctx.args.begin() + 1, ctx.args.end()));
+        ResponseSerializer::serialize_array_header(ctx.response, static_cast<uint32_t>(values.size()), ctx.format);
+        for (const Value* value : values) {
+            // missing keys and keys of another type are nil, an error would fail the whole reply
+            if (value && value->is_string()) {
+                serialize_value(ctx, *value);
+            } else {
+                ResponseSerializer::serialize_nil(ctx.response);
+            }
+        }
+    }
+
+    static void handle_mset(const CommandContext& ctx) {
+        if (ctx.args.size() < 3 || ctx.args.size() % 2 == 0) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "MSET requires key value pairs\n", ctx.format);
+        }
+
+        for (size_t i = 1; i + 1 < ctx.args.size(); i += 2) {
+            if (!ctx.entry_manager.make_room(ctx.args[i])) {
+                return serialize_oom(ctx);
+            }
+        }
+        std::vector<std::pair<std::string, Value>> items;
+        items.reserve(ctx.args.size() / 2);
+        for (size_t i = 1; i + 1 < ctx.args.size(); i += 2) {
+            bool last = i + 2 == ctx.args.size();
+            Value value = last && ctx.streamed ? Value::string(std::move(*ctx.streamed)) : Value::string(ctx.args[i + 1]);
+            items.emplace_back(std::string(ctx.args[i]), std::move(value));
+        }
+        ctx.entry_manager.create_entries(std::move(items));
+        ResponseSerializer::serialize_string(ctx.response, "OK", ctx.format);
+    }
+
+    static void handle_mdel(const CommandContext& ctx) {
+        if (ctx.args.size() < 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "MDEL requires at least one key\n", ctx.format);
+        }
+
+        size_t deleted = ctx.entry_manager.delete_entries(std::span(ctx.args.begin() + 1, ctx.args.end()));
+        ResponseSerializer::serialize_integer(ctx.response, static_cast<int64_t>(deleted), ctx.format);
+    }
+
+    // HELLO [version]: switches this connection's reply format (see ResponseFormat) and describes the server, in the
+    // format just picked. Without a version it only reports the current one.
+    static void handle_hello(const CommandContext& ctx) {
+        if (ctx.args.size() > 2) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "HELLO takes at most a protocol version\n", ctx.format);
+        }
+
+        ResponseFormat format = ctx.format;
+        if (ctx.args.size() == 2) {
+            int64_t version;
+            if (!ArgParser::parse_int(ctx.args[1], version) || version < static_cast<int64_t>(ResponseFormat::V1) ||
+                version > static_cast<int64_t>(ResponseFormat::V2)) {
+                return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "unsupported protocol version\n", ctx.format);
+            }
+            format = static_cast<ResponseFormat>(version);
+            if (ctx.session_format) {
+                *ctx.session_format = format;
+            }
+        }
+
+        ResponseSerializer::serialize_map_header(ctx.response, 2, format);
+        ResponseSerializer::serialize_string(ctx.response, "server", format);
+        ResponseSerializer::serialize_string(ctx.response, "vectordb", format);
+        ResponseSerializer::serialize_string(ctx.response, "proto", format);
+        ResponseSerializer::serialize_integer(ctx.response, static_cast<int64_t>(format), format);
+    }
+
+    static void handle_exists(const CommandContext& ctx) {
         if (ctx.args.size() != 2) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "EXISTS requires key\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "EXISTS requires key\n", ctx.format);
         }
     
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        ResponseSerializer::serialize_integer(ctx.response, entry ? 1 : 0);
+        Value* value = ctx.entry_manager.find_entry(ctx.args[1]);
+        ResponseSerializer::serialize_integer(ctx.response, value ? 1 : 0, ctx.format);
     }
     
-    static void handle_flushall(CommandContext ctx) {
+    static void handle_flushall(const CommandContext& ctx) {
         bool cleared = ctx.entry_manager.clear_all();
-        ResponseSerializer::serialize_integer(ctx.response, cleared ? 1 : 0);
+        ResponseSerializer::serialize_integer(ctx.response, cleared ? 1 : 0, ctx.format);
     }      
 
-    static void handle_zadd(CommandContext ctx) {
+    static void handle_zadd(const CommandContext& ctx) {
         if (ctx.args.size() != 4) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "ZADD requires key, score, and member\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "ZADD requires key, score, and member\n", ctx.format);
         }
     
         double score;
-        if (!parse_double(ctx.args[2], score)) {
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid score value\n");
+        if (!ArgParser::parse_double(ctx.args[2], score)) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid score value\n", ctx.format);
+        }
+        if (!ctx.entry_manager.make_room(ctx.args[1])) {
+            return serialize_oom(ctx);
         }
     
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        std::shared_ptr<Entry<std::unique_ptr<ZSet>>> zset_entry;
-    
-        if (entry) {
-            zset_entry = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(entry);
-            if (!zset_entry) {
-                return ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n");
-            }
-        } else {
-            auto new_entry = ctx.entry_manager.create_entry(ctx.args[1], std::make_unique<ZSet>());
-            zset_entry = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(new_entry);
+        Value* value = ctx.entry_manager.find_entry(ctx.args[1]);
+        if (!value) {
+            value = &ctx.entry_manager.create_entry(std::string(ctx.args[1]), Value::zset(std::make_unique<ZSet>()));
+        }
+
+        ZSet* zset = value->zset();
+        if (!zset) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n", ctx.format);
         }
     
-        bool added = zset_entry->value->add_internal(ctx.args[3], score);
-        ResponseSerializer::serialize_integer(ctx.response, added ? 1 : 0);
+        size_t before = value->memory_usage();
+        bool added = zset->add_internal(ctx.args[3], score);
+        ctx.entry_manager.note_resize(ctx.args[1], before, value->memory_usage());
+        ResponseSerializer::serialize_integer(ctx.response, added ? 1 : 0, ctx.format);
     }
     
-    static void handle_zrem(CommandContext ctx) {
+    static void handle_zrem(const CommandContext& ctx) {
         if (ctx.args.size() != 3) { 
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "ZREM requires key and member\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "ZREM requires key and member\n", ctx.format);
         }
     
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        if (!entry) { 
-            ResponseSerializer::serialize_integer(ctx.response, 0);
+        Value* value = ctx.entry_manager.find_entry(ctx.args[1]);
+        if (!value) { 
+            ResponseSerializer::serialize_integer(ctx.response, 0, ctx.format);
             return;
         }
     
-        auto zset_entry = std::dynamic_pointer_cast<Entry<std::unique_ptr<ZSet>>>(entry);
-        if (!zset_entry) {
-            return ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n");
+        ZSet* zset = value->zset();
+        if (!zset) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_TYPE, "Key holds wrong type\n", ctx.format);
         }
     
-        bool removed = zset_entry->value->remove_internal(ctx.args[2]); 
-        ResponseSerializer::serialize_integer(ctx.response, removed ? 1 : 0);
+        size_t before = value->memory_usage();
+        bool removed = zset->remove_internal(ctx.args[2]);
+        ctx.entry_manager.note_resize(ctx.args[1], before, value->memory_usage());
+        ResponseSerializer::serialize_integer(ctx.response, removed ? 1 : 0, ctx.format);
     }
     
 
-    static void handle_pexpire(CommandContext ctx) {
+    static void handle_pexpire(const CommandContext& ctx) {
         if (ctx.args.size() != 3) {
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "PEXPIRE requires key and TTL\n");
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "PEXPIRE requires key and TTL\n", ctx.format);
         }
     
         int64_t ttl_ms;
-        if (!parse_int(ctx.args[2], ttl_ms) || ttl_ms < 0) {
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid TTL value\n");
-        }
-    
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        if (!entry) {
-            ResponseSerializer::serialize_integer(ctx.response, 0);  // Key does not exist
-            return;
+        if (!ArgParser::parse_int(ctx.args[2], ttl_ms) || ttl_ms < 0) {
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "Invalid TTL value\n", ctx.format);
         }
     
-        bool success = ctx.entry_manager.set_entry_ttl(*entry, ttl_ms);
-        ResponseSerializer::serialize_integer(ctx.response, success ? 1 : 0);
+        bool success = ctx.entry_manager.set_entry_ttl(ctx.args[1], ttl_ms);  // false if the key does not exist
+        ResponseSerializer::serialize_integer(ctx.response, success ? 1 : 0, ctx.format);
     }
     
     
 
-    static void handle_pttl(CommandContext ctx) {
+    static void handle_pttl(const CommandContext& ctx) {
         if (ctx.args.size() != 2) {
-            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "PTTL requires key\n");
-        }
-    
-        auto entry = ctx.entry_manager.find_entry(ctx.args[1]);
-        if (!entry) {
-            ResponseSerializer::serialize_integer(ctx.response, -2);  // Redis returns -2 if key doesn't exist
-            return;
-        }
-    
-        int64_t ttl = ctx.entry_manager.get_expiry_time(*entry);
-        ResponseSerializer::serialize_integer(ctx.response, ttl);
-    }
-    
-        // helper function to convert a string to lowercase safely
-    static inline std::string to_lower(std::string_view str) {
-        std::string result;
-        result.reserve(str.size()); // reserve memory for efficiency
-        std::transform(str.begin(), str.end(), std::back_inserter(result),
-                        [](unsigned char c) { return std::tolower(c); }); // convert each character to lowercase
-        return result;
-    }
-
-    // helper function to parse double values safely w. try catch blocks.
-    static bool parse_double(const std::string& str, double& out) {
-        try {
-            size_t pos;
-            out = std::stod(str, &pos);
-            return pos == str.size() && !std::isnan(out);
-        } catch (const std::invalid_argument& e) {
-            return false;
-        } catch (const std::out_of_range& e) {
-            return false;
+            return ResponseSerializer::serialize_error(ctx.response, ERR_ARG, "PTTL requires key\n", ctx.format);
         }
-    }
     
-        // helper function to parse int values safely w. try catch blocks.
-    static bool parse_int(const std::string& str, int64_t& out) {
-        try {
-            size_t pos;
-            out = std::stoll(str, &pos);
-            return pos == str.size() && !std::isnan(out);
-        } catch (const std::invalid_argument& e) {
-            return false;
-        } catch (const std::out_of_range& e) {
-            return false;
-        }
-    }
-        // function to get current time in microseconds
-    static std::uint64_t get_monotonic_usec() {
-        using namespace std::chrono;
-        return duration_cast<microseconds>(
-            steady_clock::now().time_since_epoch()).count();
+        int64_t ttl = ctx.entry_manager.get_expiry_time(ctx.args[1]);  // -2 if the key doesn't exist, like Redis
+        ResponseSerializer::serialize_integer(ctx.response, ttl, ctx.format);
     }
 };
 
-const std::unordered_map<std::string, std::function<void(CommandProcessor::CommandContext)>>
-CommandProcessor::command_handlers = {
-    {"get", handle_get},
-    {"set", handle_set},
-    {"del", handle_del},
-    {"exists", handle_exists},
-    {"zadd", handle_zadd},
-    {"zrem", handle_zrem},
-    {"flushall", handle_flushall},
-    {"pexpire", handle_pexpire},
-    {"pttl", handle_pttl}        
-};
+inline constexpr std::array<CommandProcessor::CommandHandler, CommandProcessor::COMMAND_COUNT>
+CommandProcessor::command_handlers = {{
+    {"get",      handle_get,      KeySpan::Single, false, false},
+    {"set",      handle_set,      KeySpan::Single, true,  false},
+    {"del",      handle_del,      KeySpan::Single, true,  false},
+    {"exists",   handle_exists,   KeySpan::Single, false, false},
+    {"hello",    handle_hello,    KeySpan::None,   false, false},
+    {"mget",     handle_mget,     KeySpan::Each,   false, true},
+    {"mset",     handle_mset,     KeySpan::Pairs,  true,  true},
+    {"mdel",     handle_mdel,     KeySpan::Each,   true,  true},
+    {"zadd",     handle_zadd,     KeySpan::Single, true,  true},
+    {"zrem",     handle_zrem,     KeySpan::Single, true,  true},
+    {"flushall", handle_flushall, KeySpan::All,    true,  true},
+    {"pexpire",  handle_pexpire,  KeySpan::Single, true,  false},
+    {"pttl",     handle_pttl,     KeySpan::Single, false, false}
+}};
+
+inline constexpr uint32_t CommandProcessor::dispatch_seed = find_dispatch_seed();
+inline constexpr std::array<const CommandProcessor::CommandHandler*, CommandProcessor::DISPATCH_SLOTS>
+CommandProcessor::dispatch_slots = build_dispatch_slots(dispatch_seed);
+
+static_assert(CommandProcessor::dispatch_seed != 0, "no collision-free dispatch seed (grow DISPATCH_SLOTS) or a command name is not lowercase letters");
 
 #endif
\ No newline at end of file
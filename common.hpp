@@ -28,7 +28,18 @@ enum class SerializationType : uint8_t {
     Error   = 1,
     String  = 2,
     Integer = 3,
-    Double  = 4
+    Double  = 4,
+    Array   = 5,    // count, then that many serialized elements
+    Map     = 6,    // pair count, then key and value elements alternating
+    Bulk    = 7     // stored values, binary safe (V1 sends these as String)
+};
+
+// Reply wire format, picked per connection with HELLO. V1 is the original: 4 byte lengths and counts, integers as
+// decimal text + "\r\n". V2 writes lengths, counts and integers (zigzag) as LEB128 varints and adds Map and Bulk.
+// Doubles are the raw 8 bytes in both.
+enum class ResponseFormat : uint8_t {
+    V1 = 1,
+    V2 = 2
 };
 
 template<typename T>
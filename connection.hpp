@@ -12,15 +12,35 @@
 #include <unistd.h>       
 #include <cerrno>         
 #include <mutex>          
+#include <string_view>
+#include <cstring>
+#include <sys/socket.h>
 #include "socket.hpp"               
 #include "request_parser.hpp"       
 #include "response_serializer.hpp"  
 #include "command_processor.hpp"   
 #include "entry_manager.hpp"        
+#include "src/ring_buffer.hpp"
+#include "src/timer_wheel.hpp"
+#include "output_queue.hpp"
+#include "offload.hpp"
+#include "logging.hpp"
 
-static constexpr size_t MAX_MSG_SIZE = 4096; 
-static constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(5000); 
+static constexpr size_t MAX_MSG_SIZE = 4096;  // initial buffer size and the least free space a read asks for
+static constexpr size_t MAX_FRAME_SIZE = (1u << 24) - 1;  // keeps a binary frame's first length byte 0
+static constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(5000);  // default, see ConnectionLimits::idle_timeout
 static constexpr uint16_t SERVER_PORT = 4321; 
+static constexpr int MAX_SEND_IOVECS = 64;  // per sendmsg, one ring segment or referenced value each
+
+// Per-connection memory bounds. A connection holds at most one partial frame (max_frame_size) plus the replies
+// it has not been able to send (max_pending_output) - past that it stops executing requests until the client
+// reads, so a slow or hostile client costs a bounded amount rather than whatever it can pipeline.
+struct ConnectionLimits {
+    size_t max_frame_size = MAX_FRAME_SIZE;       // clamped to MAX_FRAME_SIZE, see above
+    size_t max_pending_output = 64u << 20;
+    size_t stream_threshold = 32u << 10;          // a last argument at least this big skips rbuf_, see body_
+    std::chrono::milliseconds idle_timeout = IDLE_TIMEOUT;  // closed by the reactor after this long without input
+};
 
 
 enum class ConnectionState : uint8_t {
@@ -34,86 +54,286 @@ using Result = std::expected<T, std::error_code>;
 
 class Connection {
     public:
-        Connection(Socket socket, EntryManager& entry_manager, CommandProcessor& processor)
+        Connection(Socket socket, EntryManager& entry_manager, CommandProcessor& processor,
+                   ConnectionLimits limits = {}, Offloader* offloader = nullptr)
             : socket_(std::move(socket)), 
               entry_manager_(entry_manager), 
               command_processor_(processor),
               state_(ConnectionState::Request),
-              idle_start_(std::chrono::steady_clock::now()) {
-            rbuf_.reserve(MAX_MSG_SIZE);
-            wbuf_.reserve(MAX_MSG_SIZE);
+              limits_(limits),
+              offloader_(offloader),
+              rbuf_(MAX_MSG_SIZE),
+              wbuf_(MAX_MSG_SIZE),
+              inflight_(0) {
+            limits_.max_frame_size = std::min(limits_.max_frame_size, MAX_FRAME_SIZE);
         }
     
 
     [[nodiscard]] int fd() const noexcept { return socket_.get(); }  
     [[nodiscard]] ConnectionState state() const noexcept { return state_; }  
-    [[nodiscard]] auto idle_start() const noexcept { return idle_start_; }  
-    
-    void update_idle_time() noexcept { idle_start_ = std::chrono::steady_clock::now(); } 
     Result<void> process_io();
+    Result<void> process_requests();
 
 private:
+    friend class Reactor;  // the io_uring backend drives rbuf_/wbuf_ and the in-flight state below directly
+
     Socket socket_;  
     EntryManager& entry_manager_;  
     CommandProcessor& command_processor_;  
     ConnectionState state_; 
-    std::chrono::steady_clock::time_point idle_start_;  
-    std::vector<uint8_t> rbuf_;  
-    std::vector<uint8_t> wbuf_; 
-    size_t wbuf_sent_{0};  
+    ConnectionLimits limits_;
+    Offloader* offloader_;  // null runs every command inline
+    TimerWheel<Connection>::Node idle_timer_{this};  // the reactor's idle wheel, unlinks itself on destruction
+    RingBuffer rbuf_;  
+    OutputQueue wbuf_; 
+    std::vector<uint8_t> reply_;  // scratch a single reply is serialized into before it joins wbuf_
+    std::vector<ValueRef> reply_refs_;  // large values reply_ references, spliced in by wbuf_ without a copy
+    ResponseFormat format_{ResponseFormat::V1};  // reply wire format, changed by HELLO
+    bool held_back_{false};       // requests were left in rbuf_ because wbuf_ hit max_pending_output or a batch is out
+
+    // Offloaded commands: batch_ collects them while rbuf_ is walked and is submitted at the end. While it is out
+    // (offloaded_) nothing else runs and the socket is not read, the reactor resumes us when it comes back.
+    std::unique_ptr<OffloadBatch> batch_;
+    bool offloaded_{false};
+
+    // A binary frame whose last argument is at least stream_threshold bytes is not assembled in rbuf_: the
+    // leading arguments (command, key - short) are copied out and the big one is read straight into body_,
+    // which handlers that store it (SET) move into the entry. So a 1MB value is copied zero times, not twice.
+    bool streaming_{false};
+    std::vector<std::string> stream_args_;
+    std::string body_;
+    size_t body_filled_{0};
+
+    // io_uring only: the kernel owns inflight_ (and the iovecs/msghdr describing it) until its sendmsg completes,
+    // replies produced meanwhile queue in wbuf_.
+    OutputQueue inflight_;
+    iovec send_iov_[MAX_SEND_IOVECS];
+    msghdr send_msg_{};
+
+    // The connection cannot be freed while an SQE or an offloaded batch referencing it is outstanding, closing_
+    // marks one that is only waiting for those to come back.
+    uint32_t pending_ops_{0};
+    bool closing_{false};
+
+    [[nodiscard]] bool output_full() const noexcept { return wbuf_.size() >= limits_.max_pending_output; }
 
     Result<void> handle_request();
     Result<void> handle_response();
     Result<bool> try_fill_buffer();
+    Result<bool> try_fill_body();
     Result<bool> try_flush_buffer();
-    Result<bool> try_process_request();
+    Result<bool> try_process_request(std::span<const uint8_t> buffered, size_t& offset);
+    bool try_start_streaming(std::span<const uint8_t> frame, uint32_t frame_len);
+    void finish_streaming();
+    void dispatch(const CommandArgs& args, bool framed, std::string* streamed = nullptr);
+    void submit_batch();
+    void execute(const CommandArgs& args, std::string* streamed = nullptr);
+    void append_reply();
+    void append_framed_reply();
 };
 
-Result<void> Connection::process_io() {
-    char buffer[1024] = {0};
-    ssize_t bytes_read = read(socket_.get(), buffer, sizeof(buffer) - 1);
+// One readiness event: finish any reply the socket pushed back on last time, read until EAGAIN running every
+// complete request on the way, then flush all of their replies together. A client pipelining N commands pays
+// one round trip and a couple of syscalls. Works under level-triggered poll and edge-triggered epoll.
+//
+// If the output cap held requests back and the flush then drained completely, nothing will wake us for them
+// (edge-triggered, the bytes are already read), so go around again.
+inline Result<void> Connection::process_io() {
+    while (true) {
+        if (state_ == ConnectionState::Response) {
+            auto flushed = handle_response();
+            if (!flushed) {
+                return std::unexpected(flushed.error());
+            }
+            if (state_ == ConnectionState::Response) {
+                return {};  // still backed up, don't read more until the client drains its replies
+            }
+        }
 
-    if (bytes_read > 0) {
-        buffer[bytes_read] = '\0';  
-        std::string request(buffer);
-        std::cout << " Received command: " << request << std::endl;
+        if (held_back_) {
+            auto resumed = process_requests();
+            if (!resumed) {
+                return std::unexpected(resumed.error());
+            }
+        }
 
-        std::vector<std::string> args;
-        std::istringstream iss(request);
-        std::string word;
-        while (iss >> word) {
-            args.push_back(word);
+        auto read = handle_request();
+        if (!read) {
+            return std::unexpected(read.error());
         }
 
-        std::vector<uint8_t> response;
-        CommandProcessor::CommandContext ctx{args, response, entry_manager_};  
-        command_processor_.process_command(ctx);
+        // on EOF this is best effort, the replies to whatever arrived with the FIN still go out before we close
+        auto flushed = handle_response();
+        if (!flushed) {
+            return std::unexpected(flushed.error());
+        }
+        if (state_ != ConnectionState::Request || offloaded_ || (!held_back_ && !output_full())) {
+            return {};
+        }
+    }
+}
 
-        std::string response_str(response.begin(), response.end());
-        ssize_t bytes_sent = write(socket_.get(), response_str.c_str(), response.size());
+// Runs every complete request sitting in rbuf_ and appends the replies to wbuf_. Handled frames are released
+// with a single consume at the end (a counter bump, nothing is moved). Shared by the readiness loops and io_uring.
+//
+// Two framings are accepted and told apart by their first byte: a binary frame starts with a 4-byte
+// big-endian length (so a leading 0, see MAX_FRAME_SIZE), anything else is an inline text command
+// terminated by '\n', which is what nc/telnet send.
+inline Result<void> Connection::process_requests() {
+    if (offloaded_) {
+        // io_uring keeps appending to rbuf_, these run once the batch is back
+        if (rbuf_.size() > limits_.max_frame_size + limits_.max_pending_output) {
+            return std::unexpected(std::make_error_code(std::errc::message_size));
+        }
+        return {};
+    }
 
-        if (bytes_sent < 0) {
-            std::cerr << " Write failed: " << strerror(errno) << std::endl;
-        } else {
-            std::cout << " Sent response: " << response_str << std::endl;
+    if (streaming_) {
+        // io_uring lands everything in rbuf_ first, move what belongs to the body across
+        auto pending = rbuf_.contiguous();
+        size_t take = std::min(pending.size(), body_.size() - body_filled_);
+        std::memcpy(body_.data() + body_filled_, pending.data(), take);
+        body_filled_ += take;
+        rbuf_.consume(take);
+        if (body_filled_ < body_.size()) {
+            return {};
+        }
+        finish_streaming();
+        if (offloaded_) {
+            return {};
         }
+    }
 
-        return {};
-    } else if (bytes_read == 0) {
-        std::cerr << "Client disconnected.\n";
-        return std::unexpected(std::make_error_code(std::errc::connection_reset));
+    auto pending = rbuf_.contiguous();  // the CommandArgs views point in here
+    size_t offset = 0;
+    held_back_ = false;
+    while (!streaming_) {
+        if (output_full()) {
+            held_back_ = true;
+            break;
+        }
+        auto more = try_process_request(pending, offset);
+        if (!more) {
+            return std::unexpected(more.error());
+        }
+        if (!*more || (batch_ && batch_->size() >= MAX_OFFLOAD_BATCH)) {
+            break;
+        }
+    }
+
+    rbuf_.consume(offset);
+    submit_batch();
+    size_t allowed = limits_.max_frame_size + (held_back_ ? limits_.max_pending_output : 0);
+    if (!streaming_ && rbuf_.size() > allowed) {
+        return std::unexpected(std::make_error_code(std::errc::message_size));  // a text line that never ends
+    }
+    return {};
+}
+
+// Runs a parsed request now, or adds it to batch_ when the offloader wants it. Once a batch is started every later
+// request joins it, cheap or not, an inline reply must not overtake the ones still on the pool.
+inline void Connection::dispatch(const CommandArgs& args, bool framed, std::string* streamed) {
+    if (!batch_ && offloader_ && offloader_->wants(args)) {
+        batch_ = std::make_unique<OffloadBatch>(this, format_);
+    }
+    if (batch_) {
+        batch_->add(args, framed, streamed);
+        return;
+    }
+
+    execute(args, streamed);
+    if (framed) {
+        append_framed_reply();
     } else {
-        std::cerr << " Read error: " << strerror(errno) << std::endl;
-        return std::unexpected(std::make_error_code(std::errc::io_error));
+        append_reply();
     }
 }
 
+inline void Connection::submit_batch() {
+    if (!batch_) {
+        return;
+    }
+    offloaded_ = true;
+    held_back_ = true;  // whatever is still in rbuf_ runs when the reactor hands the batch back
+    pending_ops_++;
+    offloader_->submit(std::move(batch_));
+}
 
+// serializes into reply_ and appends it whole, so a reply never depends on where wbuf_ happens to wrap
+inline void Connection::execute(const CommandArgs& args, std::string* streamed) {
+    reply_.clear();
+    reply_refs_.clear();
+    CommandProcessor::CommandContext ctx{args, reply_, entry_manager_, streamed, &reply_refs_, format_, &format_};
+    command_processor_.process_command(ctx);
+}
 
+inline void Connection::append_reply() {
+    wbuf_.append(reply_, reply_refs_);
+    reply_refs_.clear();
+}
+
+inline void Connection::append_framed_reply() {
+    size_t len = reply_.size();
+    for (const auto& ref : reply_refs_) {
+        len += ref.bytes.size();
+    }
+    uint32_t wlen = static_cast<uint32_t>(len);
+    wbuf_.append(&wlen, sizeof(wlen));
+    append_reply();
+}
+
+// frame is everything buffered from the frame's length prefix on. Streams only when the last argument is the
+// big one and all the argument headers before it have arrived, otherwise the frame is assembled as usual.
+inline bool Connection::try_start_streaming(std::span<const uint8_t> frame, uint32_t frame_len) {
+    const size_t frame_end = sizeof(uint32_t) + frame_len;
+    size_t pos = sizeof(uint32_t);
+    std::vector<std::string> leading;
+
+    while (pos + sizeof(uint32_t) <= frame.size()) {
+        uint32_t str_len;
+        std::memcpy(&str_len, frame.data() + pos, sizeof(str_len));
+        str_len = __builtin_bswap32(str_len);
+        size_t data_at = pos + sizeof(uint32_t);
+
+        if (data_at + str_len == frame_end && str_len >= limits_.stream_threshold) {
+            size_t have = frame.size() - data_at;
+            body_.resize_and_overwrite(str_len, [&](char* dst, size_t n) {
+                std::memcpy(dst, frame.data() + data_at, have);
+                return n;
+            });
+            body_filled_ = have;
+            stream_args_ = std::move(leading);
+            streaming_ = true;
+            return true;
+        }
+        if (data_at + str_len >= frame_end || data_at + str_len > frame.size()) {
+            return false;
+        }
+        leading.emplace_back(reinterpret_cast<const char*>(frame.data() + data_at), str_len);
+        pos = data_at + str_len;
+    }
+    return false;
+}
+
+inline void Connection::finish_streaming() {
+    CommandArgs args;
+    for (const auto& arg : stream_args_) {
+        args.push_back(arg);
+    }
+    args.push_back(body_);
+    dispatch(args, true, &body_);
+    submit_batch();
 
+    streaming_ = false;
+    stream_args_.clear();
+    body_ = std::string();  // moved from by SET, and if not, a multi-MB buffer is not worth keeping around
+    body_filled_ = 0;
+}
+
+// stops early once max_pending_output worth of replies is queued, process_io comes back after the flush
 inline Result<void> Connection::handle_request() {
-    while (true) {
-        auto result = try_fill_buffer(); 
+    while (!output_full() && !offloaded_) {
+        auto result = streaming_ ? try_fill_body() : try_fill_buffer(); 
         if (!result) {
             return std::unexpected(result.error()); 
         }
@@ -137,17 +357,20 @@ inline Result<void> Connection::handle_response() {
     return {};
 }
 
+// readv straight into the ring's free space (both segments when it wraps), growing it first if it is nearly full
 inline Result<bool> Connection::try_fill_buffer() {
-    assert(rbuf_.size() < MAX_MSG_SIZE); 
-    
+    rbuf_.reserve(MAX_MSG_SIZE);
+
+    iovec iov[2];
+    int iov_count = rbuf_.writable(iov);
+
     ssize_t rv;
     do {
-        size_t capacity = MAX_MSG_SIZE - rbuf_.size();
-        rv = read(socket_.get(), rbuf_.data() + rbuf_.size(), capacity);
+        rv = readv(socket_.get(), iov, iov_count);
     } while (rv < 0 && errno == EINTR);
     
     if (rv < 0) {
-        if (errno == EAGAIN) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return false; 
         }
         return std::unexpected(std::make_error_code(std::errc::io_error)); 
@@ -158,79 +381,127 @@ inline Result<bool> Connection::try_fill_buffer() {
         return false;
     }
 
-    rbuf_.resize(rbuf_.size() + rv);
-    
-    while (try_process_request()) {} 
-    
+    rbuf_.commit(static_cast<size_t>(rv));
+
+    auto processed = process_requests();
+    if (!processed) {
+        return std::unexpected(processed.error());
+    }
+    return true;
+}
+
+// while a big argument is streaming the socket is read straight into body_, no ring in between
+inline Result<bool> Connection::try_fill_body() {
+    ssize_t rv;
+    do {
+        rv = read(socket_.get(), body_.data() + body_filled_, body_.size() - body_filled_);
+    } while (rv < 0 && errno == EINTR);
+
+    if (rv < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        return std::unexpected(std::make_error_code(std::errc::io_error));
+    }
+
+    if (rv == 0) {
+        state_ = ConnectionState::End;
+        return false;
+    }
+
+    body_filled_ += static_cast<size_t>(rv);
+    if (body_filled_ == body_.size()) {
+        finish_streaming();
+    }
     return true;
 }
 
-inline Result<bool> Connection::try_process_request() {
-    if (rbuf_.size() < sizeof(uint32_t)) {
+// runs the request starting at buffered[offset] if it is complete and advances offset past it
+inline Result<bool> Connection::try_process_request(std::span<const uint8_t> buffered, size_t& offset) {
+    auto pending = buffered.subspan(offset);
+    if (pending.empty()) {
+        return false;
+    }
+
+    if (pending[0] != 0) {
+        const void* newline = std::memchr(pending.data(), '\n', pending.size());
+        if (!newline) {
+            return false;
+        }
+        size_t line_len = static_cast<size_t>(static_cast<const uint8_t*>(newline) - pending.data());
+        std::string_view line(reinterpret_cast<const char*>(pending.data()), line_len);
+        offset += line_len + 1;
+
+        auto args = RequestParser::parse_inline(line);
+        if (!args) {
+            return std::unexpected(args.error());
+        }
+        if (!args->empty()) {
+            LOG_TRACE("Received command: {}", line);
+            dispatch(*args, false);
+        }
+        return true;
+    }
+
+    if (pending.size() < sizeof(uint32_t)) {
         return false; 
     }
-    
-    auto parse_result = RequestParser::parse(std::span(rbuf_));
-    if (!parse_result) {
-        state_ = ConnectionState::End; 
+    uint32_t len;
+    std::memcpy(&len, pending.data(), sizeof(len));
+    len = __builtin_bswap32(len);
+    if (sizeof(uint32_t) + len > limits_.max_frame_size) {
+        return std::unexpected(std::make_error_code(std::errc::message_size));
+    }
+    if (pending.size() < sizeof(uint32_t) + len) {
+        // not behind a batch being built, the streamed command would finish (and reply) ahead of it
+        if (len >= limits_.stream_threshold && !batch_ && try_start_streaming(pending, len)) {
+            offset += pending.size();  // all of it belongs to this frame and now lives in stream_args_/body_
+        }
         return false;
     }
     
-    auto& cmd = *parse_result;
-    
-    std::vector<uint8_t> response;
-    CommandProcessor::CommandContext ctx{
-        cmd, response, entry_manager_
-    };
-    
-    command_processor_.process_command(ctx);
-    
-    uint32_t wlen = static_cast<uint32_t>(response.size());
-    wbuf_.clear();
-    wbuf_.reserve(sizeof(wlen) + response.size());
-    ResponseSerializer::append_data(wbuf_, wlen);
-    wbuf_.insert(wbuf_.end(), response.begin(), response.end());
-
-    state_ = ConnectionState::Response;
-    wbuf_sent_ = 0;
-    
-    size_t consumed = sizeof(uint32_t) + cmd.size();
-    if (consumed < rbuf_.size()) {
-        std::copy(rbuf_.begin() + consumed, rbuf_.end(), rbuf_.begin());
-        rbuf_.resize(rbuf_.size() - consumed);
-    } else {
-        rbuf_.clear();
+    auto parse_result = RequestParser::parse_views(pending.first(sizeof(uint32_t) + len));
+    if (!parse_result) {
+        return std::unexpected(parse_result.error());
     }
     
-    return rbuf_.size() >= sizeof(uint32_t);
+    dispatch(*parse_result, true);
+
+    offset += sizeof(uint32_t) + len;
+    return true;
 }
 
+// One sendmsg carries the ring's reply bytes and any referenced values together (sendmsg rather than writev only
+// for MSG_NOSIGNAL, a client that hung up must not SIGPIPE the server).
 inline Result<bool> Connection::try_flush_buffer() {
-    while (wbuf_sent_ < wbuf_.size()) {
+    while (!wbuf_.empty()) {
+        iovec iov[MAX_SEND_IOVECS];
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(wbuf_.gather(iov, MAX_SEND_IOVECS));
+
         ssize_t rv;
         do {
-            size_t remain = wbuf_.size() - wbuf_sent_;
-            rv = write(socket_.get(), wbuf_.data() + wbuf_sent_, remain);
+            rv = sendmsg(socket_.get(), &msg, MSG_NOSIGNAL);
         } while (rv < 0 && errno == EINTR);
         
         if (rv < 0) {
-            if (errno == EAGAIN) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (state_ != ConnectionState::End) {
+                    state_ = ConnectionState::Response;
+                }
                 return false;
             }
             return std::unexpected(std::make_error_code(std::errc::io_error));
         }
         
-        wbuf_sent_ += rv;
+        wbuf_.consume(static_cast<size_t>(rv));
     }
     
-    if (wbuf_sent_ == wbuf_.size()) {
+    if (state_ != ConnectionState::End) {
         state_ = ConnectionState::Request; 
-        wbuf_sent_ = 0;
-        wbuf_.clear();
-        return false;
     }
-    
-    return true;
+    return false;
 }
 
 #endif // CONNECTION_HPP
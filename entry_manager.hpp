@@ -1,33 +1,31 @@
 #ifndef ENTRY_MANAGER_HPP
 #define ENTRY_MANAGER_HPP
 
-#include <cstdint>       
-#include <memory>        
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
-#include <unordered_set>
-#include <functional>            
-#include <string>        
-#include <optional>      
-#include <chrono>        
-#include <iostream>
-#include <type_traits>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <chrono>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "common.hpp"
-#include "response_serializer.hpp" 
-#include "src/heap.hpp"               
-#include "src/thread_pool.hpp"   
-#include "src/zset.hpp"             
+#include "logging.hpp"
+#include "value.hpp"
+#include "src/hierarchical_wheel.hpp"
+#include "src/thread_pool.hpp"
 #include "src/hashtable.hpp"
-
-template <typename T>
-struct IsValidType : std::disjunction<
-    std::is_same<T, std::string>,                             
-    std::is_same<T, int64_t>,                                 
-    std::is_same<T, double>,                                  
-    std::is_same<T, std::vector<std::string>>,               
-    std::is_same<T, std::unordered_map<std::string, std::string>>, 
-    std::is_same<T, std::unordered_set<std::string>>,        
-    std::is_same<T, std::unique_ptr<ZSet>>> {};              
+#include "src/flat_table.hpp"
 
     inline uint64_t get_monotonic_usec() {
     return std::chrono::duration_cast<std::chrono::microseconds>(
@@ -35,156 +33,806 @@ struct IsValidType : std::disjunction<
         .count();
 }
 
-class EntryBase {
-public:
-    virtual ~EntryBase() = default;
-    virtual void print() const = 0;
-    size_t heap_idx = static_cast<size_t>(-1);
-    std::string key;
+// What a write does once used memory is past max_memory: refuse (NoEviction), or drop keys until it's back under.
+// allkeys-* pick from every key, volatile-ttl only from keys with a TTL, soonest deadline first.
+enum class EvictionPolicy : uint8_t { NoEviction, AllKeysLru, AllKeysLfu, VolatileTtl };
+
+struct MemoryLimits {
+    size_t max_memory = 0;  // bytes of keyspace (see KeyspaceShard::entry_memory), 0 = unlimited
+    EvictionPolicy policy = EvictionPolicy::AllKeysLru;
 };
 
-template <typename T, typename = std::enable_if_t<IsValidType<T>::value>>
-class Entry : public EntryBase {
-public:    
-    T value; 
+// Building with -DVECTORDB_FLAT_KEYSPACE=1 stores the keys in FlatTable (open addressing, entries inline) instead
+// of the chained HTable. Its Value* only lasts until the next call on the map, which is all KeyspaceShard needs.
+#if VECTORDB_FLAT_KEYSPACE
+using KeyspaceMap = HMap<std::string, Value, FlatTable<std::string, Value>>;
+#else
+using KeyspaceMap = HMap<std::string, Value>;
+#endif
+
+// One slice of the keyspace: its own map, TTL wheel, expiry table, memory accounting and lock, so commands on
+// keys in different shards never touch the same lock or cache lines. EntryManager routes each key to its shard
+// and takes the locks (see ShardLocks), everything in here assumes the caller holds this shard's lock.
+class KeyspaceShard {
+public:
+    // Eviction is approximated like Redis does it: sample a few keys from a random spot, drop the best candidate,
+    // repeat until under the limit. A write evicts at most EVICTION_MAX_PER_WRITE keys, so lowering the limit on a
+    // full server drains it over the next writes instead of stalling one of them.
+    static constexpr size_t EVICTION_SAMPLES = 5;
+    static constexpr size_t EVICTION_MAX_PER_WRITE = 32;
+
+    // LFU: an 8 bit logarithmic access counter in the low byte of the value's access word, the minute it was last
+    // decremented in the upper 24. New keys start at LFU_INIT so they aren't evicted before their second access,
+    // the counter loses one per LFU_DECAY_MINUTES idle.
+    static constexpr uint32_t LFU_INIT = 5;
+    static constexpr uint32_t LFU_LOG_FACTOR = 10;
+    static constexpr uint32_t LFU_DECAY_MINUTES = 1;
+
+private:
+    // A key with a TTL: its deadline and its timer, linked into wheel_ in place (the map is node based, so
+    // neither moves). key points back at the map's own copy so a timer that fires knows what to delete.
+    struct Expiry {
+        uint64_t expire_at;  // usec, what PTTL and lazy expiry compare against
+        const std::string* key = nullptr;
+        HierarchicalWheel<Expiry>::Node timer{this};
+
+        explicit Expiry(uint64_t at) noexcept : expire_at(at) {}
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const noexcept { return hash_key(key); }
+    };
+
+    KeyspaceMap db_{RehashMode::Background};  // resized by EntryManager::run_rehash_cycle
+    HierarchicalWheel<Expiry> wheel_{get_monotonic_usec() / 1000};  // declared first, outlives the timers
+    // only keys that have a TTL live here (Value::has_ttl says which), most keys never pay for one
+    std::unordered_map<std::string, Expiry, KeyHash, std::equal_to<>> expires_;
+    const std::atomic<uint32_t>& lru_clock_;  // EntryManager's, shared by every shard
+    MemoryLimits limits_;                     // this shard's share of the limit
+    size_t used_memory_ = 0;
+    uint64_t evicted_keys_ = 0;
+
+public:
+    // one per shard, the lock ShardLocks takes for a key of this shard
+    mutable std::shared_mutex mutex_;
+
+    explicit KeyspaceShard(const std::atomic<uint32_t>& lru_clock) noexcept : lru_clock_(lru_clock) {}
+
+    void set_memory_limits(MemoryLimits limits) noexcept { limits_ = limits; }
+
+    [[nodiscard]] uint32_t lru_clock() const noexcept { return lru_clock_.load(std::memory_order_relaxed); }
+
+    // takes a view so a GET can probe straight from the read buffer without building a std::string. The pointer
+    // is good until the key is overwritten or deleted, i.e. for as long as the caller holds the lock.
+    // A key past its deadline is already gone as far as callers can tell. Reads only hold the shared lock, so it
+    // isn't deleted here - the next write to the key replaces it, or the active cycle reclaims it.
+    Value* find_entry(std::string_view key) {
+        Value* value = db_.find(key);
+        if (!value || is_expired(key, *value)) return nullptr;
+        access(*value);
+        return value;
+    }
+
+    // SET semantics: an existing key's value is replaced in place and loses its TTL
+    Value& create_entry(std::string key, Value value) {
+        stamp(value);
+        size_t added = value.memory_usage();
+        if (Value* existing = db_.find(std::string_view(key))) {
+            if (existing->has_ttl()) drop_ttl(key);
+            used_memory_ += added - existing->memory_usage();
+            *existing = std::move(value);
+            return *existing;
+        }
+        used_memory_ += entry_memory(key, value);
+        return db_.insert(std::move(key), std::move(value));
+    }
+
+    // batched find/create/delete for MGET/MSET/MDEL, one pass over the map for all keys (see HMap::find_many)
+    void find_entries(std::span<const std::string_view> keys, std::span<Value*> values) {
+        db_.find_many(keys, values);
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (!values[i]) continue;
+            if (is_expired(keys[i], *values[i])) {
+                values[i] = nullptr;
+                continue;
+            }
+            access(*values[i]);
+        }
+    }
+
+    // Keys that already exist are overwritten in place, the rest go in with one insert_many. A key given more than
+    // once keeps its last value, like the same SETs one after another (batches are small, the scan is quadratic).
+    void create_entries(std::vector<std::pair<std::string, Value>> items) {
+        std::vector<std::string_view> keys;
+        keys.reserve(items.size());
+        for (const auto& item : items) {
+            keys.push_back(item.first);
+        }
+        std::vector<Value*> existing(items.size());
+        db_.find_many(std::span<const std::string_view>(keys), std::span(existing));
+
+        std::vector<std::pair<std::string, Value>> fresh;
+        for (size_t i = 0; i < items.size(); ++i) {
+            stamp(items[i].second);
+            if (existing[i]) {
+                if (existing[i]->has_ttl()) drop_ttl(keys[i]);
+                used_memory_ += items[i].second.memory_usage() - existing[i]->memory_usage();
+                *existing[i] = std::move(items[i].second);
+                continue;
+            }
+            bool repeated = false;
+            for (size_t j = i + 1; j < items.size() && !repeated; ++j) {
+                repeated = keys[j] == keys[i];
+            }
+            if (!repeated) {
+                used_memory_ += entry_memory(items[i].first, items[i].second);
+                fresh.push_back(std::move(items[i]));
+            }
+        }
+        if (!fresh.empty()) {
+            db_.insert_many(std::move(fresh));
+        }
+    }
+
+    size_t delete_entries(std::span<const std::string_view> keys) {
+        std::vector<std::optional<Value>> removed(keys.size());
+        db_.remove_many(keys, std::span(removed));
+
+        size_t deleted = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!removed[i]) continue;
+            deleted += !is_expired(keys[i], *removed[i]);  // an expired key is reclaimed but wasn't there to delete
+            if (removed[i]->has_ttl()) drop_ttl(keys[i]);
+            used_memory_ -= entry_memory(keys[i], *removed[i]);
+        }
+        return deleted;
+    }
+
+    bool delete_entry(std::string_view key) {
+        auto removed = db_.remove(key);
+        if (!removed) {
+            return false;
+        }
+        bool live = !is_expired(key, *removed);
+        if (removed->has_ttl()) drop_ttl(key);
+        used_memory_ -= entry_memory(key, *removed);
+        return live;
+    }
+
+    bool clear_all() {
+        db_.clear();
+        expires_.clear();
+        used_memory_ = 0;
+        return db_.size() == 0 && wheel_.empty();
+    }
+
+
+    // false if there's no such key. ttl_ms <= 0 deletes the key, like a deadline already in the past
+    bool set_entry_ttl(std::string_view key, int64_t ttl_ms) {
+        Value* value = find_entry(key);
+        if (!value) {
+            return false;
+        }
+        if (ttl_ms <= 0) {
+            return delete_entry(key);
+        }
+
+        // saturates: a TTL too far out for the usec deadline to fit an int64 just never comes due
+        uint64_t now = get_monotonic_usec();
+        int64_t max_ttl_ms = (INT64_MAX - static_cast<int64_t>(now)) / 1000;
+        uint64_t expire_at = now + static_cast<uint64_t>(std::min(ttl_ms, max_ttl_ms)) * 1000;
+
+        auto it = expires_.find(key);
+        if (it == expires_.end()) {
+            it = expires_.try_emplace(std::string(key), expire_at).first;
+            it->second.key = &it->first;
+            value->set_ttl_flag(true);
+            used_memory_ += ttl_memory(key);
+        } else {
+            it->second.expire_at = expire_at;
+        }
+        wheel_.schedule(it->second.timer, (expire_at + 999) / 1000);  // rounded up, a key never goes early
+        return true;
+    }
+
+
+    // milliseconds left, -1 if the key has no TTL, -2 if there's no such key (or it has expired)
+    int64_t get_expiry_time(std::string_view key) {
+        Value* value = find_entry(key);
+        if (!value) {
+            return -2;
+        }
+        if (!value->has_ttl()) {
+            return -1;
+        }
+        auto it = expires_.find(key);
+        if (it == expires_.end()) {
+            return -1;
+        }
 
-    explicit Entry(std::string k, T v) : value(std::move(v)) {
-        key = std::move(k);
+        uint64_t now = get_monotonic_usec();
+        uint64_t expire_at = it->second.expire_at;
+        return expire_at > now ? static_cast<int64_t>((expire_at - now) / 1000) : 0;
+    }
+
+    // Fires every timer due by now_usec, batch at a time, and deletes those keys with one remove_many per batch.
+    // Stops early once budget is spent (after at least one batch), what's left is still due next cycle.
+    // Caller holds the write lock. Returns how many keys went.
+    size_t expire_due(uint64_t now_usec, std::chrono::microseconds budget, size_t batch) {
+        uint64_t start = get_monotonic_usec();
+        size_t expired = 0;
+
+        std::vector<std::string> keys;
+        std::vector<std::string_view> views;
+        std::vector<std::optional<Value>> removed;
+        keys.reserve(batch);
+        while (true) {
+            keys.clear();
+            wheel_.advance(now_usec / 1000, batch, [&](Expiry& expiry) {
+                auto node = expires_.extract(*expiry.key);  // destroys expiry once the key is moved out
+                keys.push_back(std::move(node.key()));
+            });
+            if (keys.empty()) break;
+
+            views.assign(keys.begin(), keys.end());
+            removed.clear();
+            removed.resize(keys.size());
+            db_.remove_many(std::span<const std::string_view>(views), std::span(removed));
+            expired += keys.size();
+            for (size_t i = 0; i < keys.size(); ++i) {
+                used_memory_ -= ttl_memory(keys[i]);
+                if (removed[i]) used_memory_ -= entry_memory(keys[i], *removed[i]);
+            }
+
+            if (get_monotonic_usec() - start >= static_cast<uint64_t>(budget.count())) break;
+        }
+        return expired;
+    }
+
+    // A write about to add data calls this first (under the write lock): evicts keys while used memory is past
+    // the limit. False means the write should be refused - the policy is noeviction, or there's nothing left the
+    // policy may evict (volatile-ttl with no TTL keys).
+    bool make_room() {
+        if (limits_.max_memory == 0 || used_memory_ <= limits_.max_memory) return true;
+        if (limits_.policy == EvictionPolicy::NoEviction) return false;
+
+        for (size_t evicted = 0; used_memory_ > limits_.max_memory && evicted < EVICTION_MAX_PER_WRITE; ++evicted) {
+            if (!evict_one()) {
+                return evicted > 0;
+            }
+        }
+        return true;
+    }
+
+    // a value changed size in place (ZADD/ZREM on an existing set), before/after from Value::memory_usage
+    void note_resize(size_t before, size_t after) noexcept { used_memory_ += after - before; }
+
+    [[nodiscard]] size_t used_memory() const noexcept { return used_memory_; }
+    [[nodiscard]] uint64_t evicted_keys() const noexcept { return evicted_keys_; }
+
+    // resize work on this shard's table until deadline (see HMap::rehash), true while a migration is running.
+    // Over FlatTable entries move, so the caller holds the shard lock exclusively; over HTable it needs none.
+    bool rehash(std::chrono::steady_clock::time_point deadline) { return db_.rehash(deadline); }
+
+private:
+    // has a TTL and its deadline has passed (the key may still be in db_, see find_entry)
+    bool is_expired(std::string_view key, const Value& value) const {
+        if (!value.has_ttl()) return false;
+        auto it = expires_.find(key);
+        return it != expires_.end() && it->second.expire_at <= get_monotonic_usec();
+    }
+
+    // the key is gone or was overwritten: forget its deadline (the timer unlinks itself, O(1))
+    void drop_ttl(std::string_view key) {
+        auto it = expires_.find(key);
+        if (it == expires_.end()) return;
+        expires_.erase(it);
+        used_memory_ -= ttl_memory(key);
+    }
+
+    // What a key costs: its hash node or slot (key and Value inline), the key's heap buffer and whatever the value
+    // owns. Bucket arrays and empty slots aren't counted, they're shared and a small fraction per key.
+    static size_t entry_memory(std::string_view key, const Value& value) noexcept {
+        return KeyspaceMap::node_bytes + string_heap_bytes(key.size()) + value.memory_usage();
+    }
+
+    // an expires_ node: the key's own copy, the Expiry and the node's next pointer and cached hash
+    static size_t ttl_memory(std::string_view key) noexcept {
+        return sizeof(std::pair<const std::string, Expiry>) + 2 * sizeof(void*) + string_heap_bytes(key.size());
+    }
+
+    // cheap per-thread randomness for picking sample spots
+    static uint32_t fast_rand() noexcept {
+        thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    [[nodiscard]] uint32_t lfu_minutes() const noexcept { return (lru_clock() / 60) & 0xFFFFFF; }
+
+    // the counter after decaying it for the minutes since it was last decremented
+    static uint32_t lfu_counter(uint32_t word, uint32_t minutes) noexcept {
+        uint32_t counter = word & 0xFF;
+        uint32_t idle = (minutes - (word >> 8)) & 0xFFFFFF;
+        uint32_t decay = idle / LFU_DECAY_MINUTES;
+        return decay >= counter ? 0 : counter - decay;
+    }
+
+    // logarithmic increment: the higher the counter, the less likely an access bumps it (255 takes ~1M hits)
+    static uint32_t lfu_bump(uint32_t counter) noexcept {
+        if (counter == 255) return counter;
+        uint32_t base = counter > LFU_INIT ? counter - LFU_INIT : 0;
+        double p = 1.0 / (base * LFU_LOG_FACTOR + 1);
+        return static_cast<double>(fast_rand()) / UINT32_MAX < p ? counter + 1 : counter;
+    }
+
+    // a read: the LRU clock, or under LFU a decayed and maybe bumped counter
+    void access(Value& value) const noexcept {
+        if (limits_.policy != EvictionPolicy::AllKeysLfu) {
+            value.touch(lru_clock());
+            return;
+        }
+        uint32_t minutes = lfu_minutes();
+        value.touch((minutes << 8) | lfu_bump(lfu_counter(value.lru(), minutes)));
     }
 
-    Entry(Entry&&) noexcept = default;
-    Entry& operator=(Entry&&) noexcept = default;
+    // a value being written
+    void stamp(Value& value) const noexcept {
+        if (limits_.policy == EvictionPolicy::AllKeysLfu) {
+            value.touch((lfu_minutes() << 8) | LFU_INIT);
+        } else {
+            value.touch(lru_clock());
+        }
+    }
 
-    Entry(const Entry&) = delete;
-    Entry& operator=(const Entry&) = delete;
+    // Samples EVICTION_SAMPLES candidates and deletes the one the policy likes least. False if there was nothing
+    // to sample. Caller holds the write lock.
+    bool evict_one() {
+        std::string victim;
+        uint64_t best = 0;
+        auto consider = [&](const std::string& key, uint64_t score) {
+            if (victim.empty() || score > best) {
+                victim = key;
+                best = score;
+            }
+        };
 
-    void print() const override {
-        if constexpr (std::is_same<T, std::unique_ptr<ZSet>>::value) {
-            std::cout << "Key: " << key << " -> ZSet (Sorted Set) {" << std::endl;
-            if (value) {
-                for (const auto& node : value->nodes_) {
-                    std::cout << "  " << node->get_key() << ": " << node->get_value() << std::endl;
+        if (limits_.policy == EvictionPolicy::VolatileTtl) {
+            // the expiry map's own buckets, from a random one on: the soonest deadline goes first
+            size_t buckets = expires_.bucket_count();
+            size_t start = fast_rand();
+            size_t seen = 0;
+            for (size_t i = 0; i < buckets && seen < EVICTION_SAMPLES && !expires_.empty(); ++i) {
+                size_t bucket = (start + i) % buckets;
+                for (auto it = expires_.begin(bucket); it != expires_.end(bucket) && seen < EVICTION_SAMPLES; ++it, ++seen) {
+                    consider(it->first, UINT64_MAX - it->second.expire_at);
                 }
-            } else {
-                std::cout << "  (empty ZSet)" << std::endl;
             }
-            std::cout << "}" << std::endl;
         } else {
-            std::cout << "Key: " << key << " -> " << value << std::endl;
+            uint32_t clock = lru_clock();
+            uint32_t minutes = lfu_minutes();
+            bool lfu = limits_.policy == EvictionPolicy::AllKeysLfu;
+            db_.sample(fast_rand(), EVICTION_SAMPLES, [&](const std::string& key, const Value& value) {
+                consider(key, lfu ? 255 - lfu_counter(value.lru(), minutes) : clock - value.lru());
+            });
         }
+
+        if (victim.empty()) return false;
+        delete_entry(victim);
+        evicted_keys_++;
+        return true;
     }
 };
 
+// The locks one command holds: the shards its keys fall in, taken in shard order so two multi-key commands can't
+// deadlock, shared for reads and exclusive for writes. Released on destruction. A bitmask rather than a list so
+// the single-key case (nearly every command) doesn't allocate.
+class ShardLocks {
+public:
+    static constexpr size_t MAX_SHARDS = 256;
+
+    ShardLocks(std::span<const std::unique_ptr<KeyspaceShard>> shards, bool exclusive) noexcept
+        : shards_(shards), exclusive_(exclusive) {}
+    ShardLocks(const ShardLocks&) = delete;
+    ShardLocks& operator=(const ShardLocks&) = delete;
+    ShardLocks(ShardLocks&& other) noexcept : shards_(other.shards_), mask_(other.mask_), exclusive_(other.exclusive_) {
+        other.mask_ = {};
+    }
+    ~ShardLocks() { unlock(); }
+
+    // marks a shard, nothing is locked until lock()
+    void add(size_t shard) noexcept { mask_[shard / 64] |= uint64_t{1} << (shard % 64); }
+    void add_all() noexcept {
+        for (size_t i = 0; i < shards_.size(); ++i) add(i);
+    }
+
+    void lock() {
+        for_each([this](std::shared_mutex& mutex) { exclusive_ ? mutex.lock() : mutex.lock_shared(); });
+    }
+
+private:
+    void unlock() noexcept {
+        for_each([this](std::shared_mutex& mutex) { exclusive_ ? mutex.unlock() : mutex.unlock_shared(); });
+        mask_ = {};
+    }
+
+    template<typename F>
+    void for_each(F&& f) {
+        for (size_t word = 0; word < mask_.size(); ++word) {
+            for (uint64_t bits = mask_[word]; bits; bits &= bits - 1) {
+                f(shards_[word * 64 + std::countr_zero(bits)]->mutex_);
+            }
+        }
+    }
+
+    std::span<const std::unique_ptr<KeyspaceShard>> shards_;
+    std::array<uint64_t, MAX_SHARDS / 64> mask_{};
+    bool exclusive_;
+};
+
+// The keyspace, split into a power-of-two number of shards by key hash. Every reactor and pool thread shares one
+// EntryManager; a command locks only the shards of the keys it names (lock_keys), so SETs and GETs on different
+// shards run in parallel instead of queueing on one keyspace lock. The calls below route each key to its shard and
+// assume the caller holds that shard's lock.
 class EntryManager {
+public:
+    // Active expiry runs at most once per interval (whichever reactor gets there first), deleting due keys in
+    // batches until none are left or the budget is spent, so a mass expiry can't stall the reactors for long.
+    static constexpr auto EXPIRE_CYCLE_INTERVAL = std::chrono::milliseconds(100);
+    static constexpr auto EXPIRE_CYCLE_BUDGET = std::chrono::microseconds(1000);
+    static constexpr size_t EXPIRE_BATCH = 64;
+
+    // Table resizes (see HMap::rehash) are worked through off the request path the same way: a check every
+    // REHASH_CHECK_INTERVAL for a table to shrink, then a cycle every REHASH_CYCLE_INTERVAL while a migration is
+    // running, with the bigger budget when the reactor running it had nothing else to do that wakeup.
+    static constexpr auto REHASH_CHECK_INTERVAL = std::chrono::milliseconds(100);
+    static constexpr auto REHASH_CYCLE_INTERVAL = std::chrono::milliseconds(1);
+    static constexpr auto REHASH_BUSY_BUDGET = std::chrono::microseconds(100);
+    static constexpr auto REHASH_IDLE_BUDGET = std::chrono::microseconds(1000);
+
+    // a few shards per thread that runs commands, so two of them rarely want the same one
+    static constexpr size_t SHARDS_PER_THREAD = 4;
+
+    struct ExpiryStats {
+        uint64_t expired_keys = 0;     // deleted by the active cycle, ever
+        uint64_t expired_per_sec = 0;  // over the last full second
+        uint64_t cycles = 0;
+        uint64_t last_cycle_usec = 0;
+        uint64_t max_cycle_usec = 0;
+    };
+
+    struct MemoryStats {
+        size_t used_memory = 0;
+        size_t max_memory = 0;
+        uint64_t evicted_keys = 0;
+    };
+
 private:
-    HMap<std::string, std::shared_ptr<EntryBase>> db_;  
-    BinaryHeap<uint64_t> heap_;                         
-    ThreadPool thread_pool_;                            
+    std::vector<std::unique_ptr<KeyspaceShard>> shards_;  // never resized after construction
+    int shard_shift_;                                     // shard = hash >> shard_shift_
+    ThreadPool thread_pool_;
+    std::atomic<uint32_t> lru_clock_{0};
+    std::atomic<int64_t> next_expire_cycle_{0};  // steady_clock ticks
+    std::atomic<int64_t> next_rehash_cycle_{0};  // steady_clock ticks
+    std::atomic<size_t> rehash_cursor_{0};       // the shard the last cycle ran out of budget on
+    ExpiryStats expiry_stats_;                   // written by the cycle under stats_mutex_
+    uint64_t expiry_window_start_ = 0;
+    uint64_t expiry_window_keys_ = 0;
+    mutable std::mutex stats_mutex_;
+    MemoryLimits limits_;
 
 public:
-    EntryManager(size_t thread_pool_size = 4)
-        : heap_(std::less<uint64_t>()), thread_pool_(thread_pool_size) {}
+    // shard_count is rounded up to a power of two (at most ShardLocks::MAX_SHARDS), see shards_for
+    EntryManager(size_t thread_pool_size = 4, size_t shard_count = 1)
+        : thread_pool_(thread_pool_size) {
+        shard_count = std::bit_ceil(std::clamp<size_t>(shard_count, 1, ShardLocks::MAX_SHARDS));
+        shard_shift_ = 64 - std::countr_zero(shard_count);
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_unique<KeyspaceShard>(lru_clock_));
+        }
+    }
+
+    // how many shards for this many threads running commands (reactors plus pool workers)
+    [[nodiscard]] static constexpr size_t shards_for(size_t threads) noexcept {
+        return std::bit_ceil(std::clamp<size_t>(threads * SHARDS_PER_THREAD, 1, ShardLocks::MAX_SHARDS));
+    }
+
+    // set once at startup, before the reactors run. Each shard gets an equal share of max_memory, keys spread
+    // evenly by hash so the shards fill at the same rate.
+    void set_memory_limits(MemoryLimits limits) noexcept {
+        limits_ = limits;
+        MemoryLimits share = limits;
+        share.max_memory = limits.max_memory == 0 ? 0 : std::max<size_t>(limits.max_memory / shards_.size(), 1);
+        for (auto& shard : shards_) {
+            shard->set_memory_limits(share);
+        }
+    }
 
+    [[nodiscard]] size_t shard_count() const noexcept { return shards_.size(); }
 
-    std::shared_ptr<EntryBase> find_entry(const std::string& key) {
-        auto entry = db_.find(key); 
-        return entry ? *entry : nullptr;
+    // High bits: the shard's own HMap indexes by the low ones, so keys in a shard still spread over its buckets.
+    [[nodiscard]] size_t shard_of(std::string_view key) const noexcept {
+        return shards_.size() == 1 ? 0 : static_cast<size_t>(hash_key(key) >> shard_shift_);
     }
-        
-    
-    template <typename T>
-    std::shared_ptr<Entry<T>> create_entry(std::string key, T value) {
-        static_assert(IsValidType<T>::value, "Invalid Redis type");
 
-        auto entry = std::make_shared<Entry<T>>(std::move(key), std::move(value));
-        db_.insert(entry->key, entry);
-        return entry;
+    // Locks the shards of keys[0], keys[step], keys[2 * step]... (step 2 for MSET's key value pairs), shared
+    // or exclusive. CommandProcessor holds one of these for the duration of a command.
+    [[nodiscard]] ShardLocks lock_keys(std::span<const std::string_view> keys, size_t step, bool exclusive) {
+        ShardLocks locks(shards_, exclusive);
+        for (size_t i = 0; i < keys.size(); i += step) {
+            locks.add(shard_of(keys[i]));
+        }
+        locks.lock();
+        return locks;
+    }
+
+    // every shard, for FLUSHALL and tests
+    [[nodiscard]] ShardLocks lock_all(bool exclusive) {
+        ShardLocks locks(shards_, exclusive);
+        locks.add_all();
+        locks.lock();
+        return locks;
+    }
+
+    // Seconds-resolution clock stamped into a value on access (Value::touch). Advanced by the reactors' timer pass
+    // rather than read from the OS clock per command.
+    [[nodiscard]] uint32_t lru_clock() const noexcept { return lru_clock_.load(std::memory_order_relaxed); }
+    void update_lru_clock(std::chrono::steady_clock::time_point now) noexcept {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        if (lru_clock() != static_cast<uint32_t>(seconds)) {  // every reactor calls this per wakeup, mostly a no-op
+            lru_clock_.store(static_cast<uint32_t>(seconds), std::memory_order_relaxed);
+        }
+    }
+
+    // see KeyspaceShard::find_entry, the pointer is good while the caller holds the key's shard lock
+    Value* find_entry(std::string_view key) { return shard(key).find_entry(key); }
+
+    // SET semantics: an existing key's value is replaced in place and loses its TTL
+    Value& create_entry(std::string key, Value value) {
+        KeyspaceShard& owner = shard(key);
+        return owner.create_entry(std::move(key), std::move(value));
+    }
+
+    // batched find/create/delete for MGET/MSET/MDEL: the keys are split by shard and each shard's part goes to
+    // its map as one batch (see HMap::find_many)
+    std::vector<Value*> find_entries(std::span<const std::string_view> keys) {
+        std::vector<Value*> values(keys.size());
+        if (shards_.size() == 1) {
+            shards_[0]->find_entries(keys, std::span(values));
+            return values;
+        }
+
+        std::vector<std::string_view> part;
+        std::vector<size_t> positions;
+        std::vector<Value*> found;
+        for_each_shard_of(keys, 1, positions, [&](KeyspaceShard& owner) {
+            part.clear();
+            for (size_t pos : positions) part.push_back(keys[pos]);
+            found.assign(part.size(), nullptr);
+            owner.find_entries(std::span<const std::string_view>(part), std::span(found));
+            for (size_t i = 0; i < positions.size(); ++i) values[positions[i]] = found[i];
+        });
+        return values;
     }
 
-    bool delete_entry(const std::string& key) {
-        auto entry = db_.find(key);
-        if (!entry) {
-            return false;  
+    // A key given more than once keeps its last value - repeats land in the same shard, in their original order.
+    void create_entries(std::vector<std::pair<std::string, Value>> items) {
+        if (shards_.size() == 1) {
+            return shards_[0]->create_entries(std::move(items));
         }
-    
-        if ((*entry)->heap_idx != static_cast<size_t>(-1)) {
-            remove_from_heap(**entry);
+
+        std::vector<std::string_view> keys;
+        keys.reserve(items.size());
+        for (const auto& item : items) {
+            keys.push_back(item.first);
         }
-        db_.remove(key);
-        return true;  
+        std::vector<size_t> positions;
+        for_each_shard_of(std::span<const std::string_view>(keys), 1, positions, [&](KeyspaceShard& owner) {
+            std::vector<std::pair<std::string, Value>> part;  // keys only viewed items up to the grouping
+            part.reserve(positions.size());
+            for (size_t pos : positions) part.push_back(std::move(items[pos]));
+            owner.create_entries(std::move(part));
+        });
     }
-    
+
+    size_t delete_entries(std::span<const std::string_view> keys) {
+        if (shards_.size() == 1) {
+            return shards_[0]->delete_entries(keys);
+        }
+
+        size_t deleted = 0;
+        std::vector<std::string_view> part;
+        std::vector<size_t> positions;
+        for_each_shard_of(keys, 1, positions, [&](KeyspaceShard& owner) {
+            part.clear();
+            for (size_t pos : positions) part.push_back(keys[pos]);
+            deleted += owner.delete_entries(std::span<const std::string_view>(part));
+        });
+        return deleted;
+    }
+
+    bool delete_entry(std::string_view key) { return shard(key).delete_entry(key); }
+
+    // caller holds every shard exclusively (lock_all)
     bool clear_all() {
-        db_.clear();
-        heap_.clear();
-        return db_.size() == 0 && heap_.size() == 0;
-    }    
-    
-
-    bool set_entry_ttl(EntryBase& entry, int64_t ttl_ms) {
-        if (ttl_ms <= 0) {  
-            return delete_entry(entry.key);  
-        }
-    
-        uint64_t expire_at = get_monotonic_usec() + static_cast<uint64_t>(ttl_ms) * 1000;
-    
-        if (entry.heap_idx == static_cast<size_t>(-1)) {
-            add_to_heap(entry, expire_at);
-        } else {
-            update_heap(entry, expire_at);
+        bool cleared = true;
+        for (auto& shard : shards_) {
+            cleared &= shard->clear_all();
         }
-    
-        return true;
+        return cleared;
     }
-    
 
-    int64_t get_expiry_time(EntryBase& entry) {
-        uint64_t now = get_monotonic_usec();
-        
-        if (entry.heap_idx == static_cast<size_t>(-1) || entry.heap_idx >= heap_.size()) {
-            return -1;  
+    // false if there's no such key. ttl_ms <= 0 deletes the key, like a deadline already in the past
+    bool set_entry_ttl(std::string_view key, int64_t ttl_ms) { return shard(key).set_entry_ttl(key, ttl_ms); }
+
+    // milliseconds left, -1 if the key has no TTL, -2 if there's no such key (or it has expired)
+    int64_t get_expiry_time(std::string_view key) { return shard(key).get_expiry_time(key); }
+
+    // Every reactor calls this once per wakeup, the first one past the interval runs the cycle (the others see
+    // the moved deadline and return). Takes the shard locks itself, so never call it from inside a command.
+    void run_expire_cycle(std::chrono::steady_clock::time_point now) {
+        int64_t due = next_expire_cycle_.load(std::memory_order_relaxed);
+        if (now.time_since_epoch().count() < due) return;
+        int64_t next = (now + EXPIRE_CYCLE_INTERVAL).time_since_epoch().count();
+        if (!next_expire_cycle_.compare_exchange_strong(due, next, std::memory_order_relaxed)) return;
+
+        expire_due(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count()),
+                   EXPIRE_CYCLE_BUDGET);
+    }
+
+    // how long a reactor may block before the next cycle is due
+    [[nodiscard]] std::chrono::milliseconds next_expire_timeout(std::chrono::steady_clock::time_point now) const noexcept {
+        return timeout_until(next_expire_cycle_.load(std::memory_order_relaxed), now);
+    }
+
+    // Like run_expire_cycle, once per wakeup from every reactor: the first one past the deadline does up to a
+    // budget of resize work, REHASH_IDLE_BUDGET if its wakeup had no events (idle) and REHASH_BUSY_BUDGET if it did.
+    void run_rehash_cycle(std::chrono::steady_clock::time_point now, bool idle) {
+        int64_t due = next_rehash_cycle_.load(std::memory_order_relaxed);
+        if (now.time_since_epoch().count() < due) return;
+        int64_t next = (now + REHASH_CHECK_INTERVAL).time_since_epoch().count();
+        if (!next_rehash_cycle_.compare_exchange_strong(due, next, std::memory_order_relaxed)) return;
+
+        if (rehash(idle ? REHASH_IDLE_BUDGET : REHASH_BUSY_BUDGET)) {
+            next_rehash_cycle_.store((now + REHASH_CYCLE_INTERVAL).time_since_epoch().count(), std::memory_order_relaxed);
         }
+    }
 
-        uint64_t expire_at = heap_[entry.heap_idx].value();
-        int64_t remaining_time = static_cast<int64_t>((expire_at - now) / 1000);  
+    [[nodiscard]] std::chrono::milliseconds next_rehash_timeout(std::chrono::steady_clock::time_point now) const noexcept {
+        return timeout_until(next_rehash_cycle_.load(std::memory_order_relaxed), now);
+    }
 
-        return remaining_time > 0 ? remaining_time : -1; 
+    // Resize work on the shards' tables until budget is spent, starting from the shard the last call ran out of
+    // budget on so a big migration can't starve the rest. Over HTable a shard's lock isn't needed, its finds don't
+    // lock and HMap serialises the writers; over FlatTable each shard is taken exclusively while it's worked on.
+    // True while some table is still mid-migration (or wasn't reached).
+    bool rehash(std::chrono::microseconds budget) {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        size_t start = rehash_cursor_.load(std::memory_order_relaxed);
+        bool pending = false;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            size_t index = (start + i) & (shards_.size() - 1);
+            if (i > 0 && std::chrono::steady_clock::now() >= deadline) {
+                rehash_cursor_.store(index, std::memory_order_relaxed);
+                return true;
+            }
+            KeyspaceShard& shard = *shards_[index];
+            if constexpr (KeyspaceMap::concurrent_reads) {
+                pending |= shard.rehash(deadline);
+            } else {
+                std::unique_lock lock(shard.mutex_);
+                pending |= shard.rehash(deadline);
+            }
+        }
+        return pending;
     }
 
-    bool remove_from_heap(EntryBase& entry) {
-        if (entry.heap_idx >= heap_.size()) return false;
-        heap_.pop();
-        entry.heap_idx = static_cast<size_t>(-1);
-        return true;
+    // Deletes keys due by now_usec, shard by shard, each under its own write lock and with an equal slice of the
+    // budget (every shard gets at least one EXPIRE_BATCH), so commands on the other shards carry on meanwhile.
+    // Takes the locks itself. Returns how many keys went.
+    size_t expire_due(uint64_t now_usec, std::chrono::microseconds budget) {
+        uint64_t start = get_monotonic_usec();
+        auto slice = budget / static_cast<int64_t>(shards_.size());
+        size_t expired = 0;
+        for (auto& shard : shards_) {
+            std::unique_lock lock(shard->mutex_);
+            expired += shard->expire_due(now_usec, slice, EXPIRE_BATCH);
+        }
+
+        std::lock_guard lock(stats_mutex_);
+        record_cycle(expired, start, get_monotonic_usec());
+        return expired;
+    }
+
+    [[nodiscard]] ExpiryStats expiry_stats() const {
+        std::lock_guard lock(stats_mutex_);
+        return expiry_stats_;
     }
 
+    // A write about to add data to key calls this first, with the key's shard locked exclusively: evicts from that
+    // shard while it's over its share of the limit. False means the write should be refused.
+    bool make_room(std::string_view key) { return shard(key).make_room(); }
 
-    bool add_to_heap(EntryBase& entry, uint64_t expire_at) {
-        if (entry.heap_idx != static_cast<size_t>(-1)) {
-            return false;  // Entry is already in the heap
+    // key's value changed size in place (ZADD/ZREM on an existing set), before/after from Value::memory_usage
+    void note_resize(std::string_view key, size_t before, size_t after) noexcept {
+        shard(key).note_resize(before, after);
+    }
+
+    // takes each shard's read lock in turn, so it's a sum over slightly different moments
+    [[nodiscard]] MemoryStats memory_stats() const {
+        MemoryStats stats{0, limits_.max_memory, 0};
+        for (const auto& shard : shards_) {
+            std::shared_lock lock(shard->mutex_);
+            stats.used_memory += shard->used_memory();
+            stats.evicted_keys += shard->evicted_keys();
         }
-        heap_.push(HeapItem<uint64_t>(expire_at, &entry.heap_idx));
-        entry.heap_idx = heap_.size() - 1;
-        heap_.update(entry.heap_idx);
-        return true;  // Successfully added to the heap
+        return stats;
     }
-    
 
-    bool update_heap(EntryBase& entry, uint64_t new_expire_at) {
-        if (entry.heap_idx >= heap_.size()) return false;
-        heap_[entry.heap_idx].set_value(new_expire_at);
-        heap_.update(entry.heap_idx);
-        return true;
+private:
+    KeyspaceShard& shard(std::string_view key) noexcept { return *shards_[shard_of(key)]; }
+
+    static std::chrono::milliseconds timeout_until(int64_t due_ticks, std::chrono::steady_clock::time_point now) noexcept {
+        std::chrono::steady_clock::time_point due{std::chrono::steady_clock::duration(due_ticks)};
+        return due <= now ? std::chrono::milliseconds(0) : std::chrono::ceil<std::chrono::milliseconds>(due - now);
+    }
+
+    // Calls f(shard) once for every shard among keys[0], keys[step]..., with positions holding the indexes into
+    // keys that fall in it, in their original order. Batches are at most a few hundred keys, the bucketing is a
+    // sort over (shard, index) pairs.
+    template<typename F>
+    void for_each_shard_of(std::span<const std::string_view> keys, size_t step, std::vector<size_t>& positions, F&& f) {
+        std::vector<std::pair<size_t, size_t>> order;
+        order.reserve(keys.size() / step + 1);
+        for (size_t i = 0; i < keys.size(); i += step) {
+            order.emplace_back(shard_of(keys[i]), i);
+        }
+        std::sort(order.begin(), order.end());
+
+        for (size_t i = 0; i < order.size();) {
+            size_t owner = order[i].first;
+            positions.clear();
+            for (; i < order.size() && order[i].first == owner; ++i) {
+                positions.push_back(order[i].second);
+            }
+            f(*shards_[owner]);
+        }
+    }
+
+    void record_cycle(size_t expired, uint64_t start, uint64_t end) {
+        uint64_t took = end - start;
+        expiry_stats_.expired_keys += expired;
+        expiry_stats_.cycles++;
+        expiry_stats_.last_cycle_usec = took;
+        expiry_stats_.max_cycle_usec = std::max(expiry_stats_.max_cycle_usec, took);
+
+        if (expiry_window_start_ == 0) {
+            expiry_window_start_ = start;
+        }
+        expiry_window_keys_ += expired;
+        if (end - expiry_window_start_ >= 1'000'000) {
+            expiry_stats_.expired_per_sec = expiry_window_keys_ * 1'000'000 / (end - expiry_window_start_);
+            if (expiry_window_keys_ > 0) {
+                LOG_DEBUG("Expired {} keys/s, last cycle {}us, max {}us", expiry_stats_.expired_per_sec,
+                          expiry_stats_.last_cycle_usec, expiry_stats_.max_cycle_usec);
+            }
+            expiry_window_start_ = end;
+            expiry_window_keys_ = 0;
+        }
     }
-    
 
     // void delete_entry_async(const std::string& key) {
-    //     thread_pool_.enqueue([this, key]() { 
-    //         delete_entry(key); 
+    //     thread_pool_.enqueue([this, key]() {
+    //         delete_entry(key);
     //     });
-    //     thread_pool_.wait_for_tasks(); 
+    //     thread_pool_.wait_for_tasks();
     // }
-    
+
 };
 
 #endif // ENTRY_MANAGER_HPP
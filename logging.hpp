@@ -1,26 +1,258 @@
 #ifndef LOGGING_HPP
 #define LOGGING_HPP
 
-#include <iostream>
-#include <string_view>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
-#include <source_location>
 #include <format>
+#include <iterator>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
-template<typename... Args>
-void log_message_impl(std::string_view format, const std::source_location& location, const Args&... args) {
-    auto time_t_val = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    char time_str[20];
-    std::strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", std::localtime(&time_t_val));
+enum class LogLevel : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
 
-    std::cerr << std::format("[{}] {}:{} - ", time_str, location.file_name(), location.line());
-    std::cerr << std::vformat(format, std::make_format_args(args...)) << '\n';
-}
+// Levels below this are compiled out: the LOG_* macro turns into nothing and its arguments are never evaluated.
+// Production builds keep the default (Info), -DVECTORDB_LOG_LEVEL=0 brings back trace.
+#ifndef VECTORDB_LOG_LEVEL
+#define VECTORDB_LOG_LEVEL 2
+#endif
+inline constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(VECTORDB_LOG_LEVEL);
+
+// Asynchronous logger. A log call formats into a fixed-size record in its own thread's ring (single producer,
+// single consumer, no locks, no allocation) and returns; a background thread drains every ring and writes the
+// batch to stderr with one write(). A full ring drops the record rather than block, so an enabled log costs one
+// bounded format and a disabled one a relaxed load.
+class Logger {
+public:
+    static constexpr size_t RECORD_SIZE = 256;
+    static constexpr size_t RING_RECORDS = 512;  // per thread, must be a power of two
+    static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        const char* file;
+        uint32_t line;
+        LogLevel level;
+        uint16_t len;
+        char text[RECORD_SIZE - sizeof(time) - sizeof(file) - sizeof(line) - sizeof(level) - sizeof(len) - 1];
+    };
+    static_assert(sizeof(Record) == RECORD_SIZE);
+
+    // never destroyed: reactor threads may still log while static destructors run after a signal
+    static Logger& instance() {
+        static Logger* logger = new Logger();
+        return *logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void set_level(LogLevel level) noexcept { level_.store(level, std::memory_order_relaxed); }
+    [[nodiscard]] LogLevel level() const noexcept { return level_.load(std::memory_order_relaxed); }
+    [[nodiscard]] bool enabled(LogLevel level) const noexcept { return level >= this->level(); }
+    [[nodiscard]] size_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    template<typename... Args>
+    void log(LogLevel level, const char* file, uint32_t line, std::format_string<Args...> format, Args&&... args) {
+        Ring& ring = local_ring();
+        Record* record = ring.claim();
+        if (!record) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto result = std::format_to_n(record->text, sizeof(record->text), format, std::forward<Args>(args)...);
+        fill(*record, level, file, line, static_cast<size_t>(result.size));
+        ring.publish();
+    }
+
+    // a format string only known at runtime, see log_message
+    void log_runtime(LogLevel level, const char* file, uint32_t line, std::string_view text) {
+        Ring& ring = local_ring();
+        Record* record = ring.claim();
+        if (!record) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        size_t len = std::min(text.size(), sizeof(record->text));
+        std::memcpy(record->text, text.data(), len);
+        fill(*record, level, file, line, len);
+        ring.publish();
+    }
+
+    // writes out everything logged so far, for shutdown and tests
+    void flush() {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        drain();
+    }
+
+private:
+    class Ring {
+    public:
+        Record* claim() noexcept {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == RING_RECORDS) {
+                return nullptr;
+            }
+            return &records_[tail & (RING_RECORDS - 1)];
+        }
+
+        void publish() noexcept { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        // writer thread only
+        template<typename F>
+        size_t consume(F&& f) {
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            uint64_t tail = tail_.load(std::memory_order_acquire);
+            for (uint64_t i = head; i < tail; ++i) {
+                f(records_[i & (RING_RECORDS - 1)]);
+            }
+            head_.store(tail, std::memory_order_release);
+            return static_cast<size_t>(tail - head);
+        }
 
+    private:
+        std::array<Record, RING_RECORDS> records_;
+        alignas(64) std::atomic<uint64_t> head_{0};
+        alignas(64) std::atomic<uint64_t> tail_{0};
+    };
+
+    std::atomic<LogLevel> level_{COMPILED_LOG_LEVEL};
+    std::atomic<size_t> dropped_{0};
+    std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;  // one per thread that ever logged, kept until exit
+    std::mutex drain_mutex_;                    // the writer thread and flush() take turns consuming
+    std::string out_;
+    std::thread writer_;
+
+    Logger() {
+        writer_ = std::thread([this] { run(); });
+        writer_.detach();
+        std::atexit([] { Logger::instance().flush(); });
+    }
+
+    Ring& local_ring() {
+        thread_local Ring* ring = register_ring();
+        return *ring;
+    }
+
+    Ring* register_ring() {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::make_unique<Ring>());
+        return rings_.back().get();
+    }
+
+    static void fill(Record& record, LogLevel level, const char* file, uint32_t line, size_t len) noexcept {
+        record.time = std::chrono::system_clock::now();
+        record.file = file;
+        record.line = line;
+        record.level = level;
+        record.len = static_cast<uint16_t>(std::min(len, sizeof(record.text)));
+    }
+
+    void run() {
+        while (true) {
+            size_t written;
+            {
+                std::lock_guard<std::mutex> lock(drain_mutex_);
+                written = drain();
+            }
+            if (written == 0) {
+                std::this_thread::sleep_for(FLUSH_INTERVAL);
+            }
+        }
+    }
+
+    // caller holds drain_mutex_
+    size_t drain() {
+        static constexpr std::string_view LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+        std::vector<Ring*> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (auto& ring : rings_) {
+                rings.push_back(ring.get());
+            }
+        }
+
+        out_.clear();
+        size_t count = 0;
+        for (Ring* ring : rings) {
+            count += ring->consume([this](const Record& record) {
+                auto seconds = std::chrono::system_clock::to_time_t(record.time);
+                auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()) % 1000;
+                char time_str[20];
+                std::tm tm_buf;
+                std::strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &tm_buf));
+
+                const char* slash = std::strrchr(record.file, '/');
+                std::format_to(std::back_inserter(out_), "[{}.{:03}] {} {}:{} - ", time_str, millis.count(),
+                               LEVEL_NAMES[static_cast<size_t>(record.level)], slash ? slash + 1 : record.file, record.line);
+                out_.append(record.text, record.len);
+                out_.push_back('\n');
+            });
+        }
+
+        for (size_t off = 0; off < out_.size();) {
+            ssize_t n = ::write(STDERR_FILENO, out_.data() + off, out_.size() - off);
+            if (n <= 0) break;
+            off += static_cast<size_t>(n);
+        }
+        return count;
+    }
+};
+
+#define VECTORDB_LOG(level, ...)                                                                  \
+    do {                                                                                          \
+        if constexpr ((level) >= COMPILED_LOG_LEVEL) {                                           \
+            if (Logger::instance().enabled(level)) {                                              \
+                Logger::instance().log((level), __FILE__, __LINE__, __VA_ARGS__);                 \
+            }                                                                                     \
+        }                                                                                         \
+    } while (0)
+
+#define LOG_TRACE(...) VECTORDB_LOG(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) VECTORDB_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)  VECTORDB_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...)  VECTORDB_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) VECTORDB_LOG(LogLevel::Error, __VA_ARGS__)
+
+// a runtime format string plus where it was written: the default argument is evaluated at the
+// log_message call, so records point at the caller instead of this header
+struct RuntimeFormat {
+    std::string_view text;
+    std::source_location loc;
+
+    template<typename S> requires std::convertible_to<const S&, std::string_view>
+    RuntimeFormat(const S& format, std::source_location loc = std::source_location::current())
+        : text(format), loc(loc) {}
+};
+
+// the original interface, logs at Info with a format string only known at runtime
 template<typename... Args>
-void log_message(std::string_view format, const Args&... args) {
-    log_message_impl(format, std::source_location::current(), args...);
+void log_message(RuntimeFormat format, const Args&... args) {
+    if (Logger::instance().enabled(LogLevel::Info)) {
+        Logger::instance().log_runtime(LogLevel::Info, format.loc.file_name(), format.loc.line(),
+                                       std::vformat(format.text, std::make_format_args(args...)));
+    }
 }
 
 #endif // LOGGING_HPP
@@ -31,12 +263,12 @@ void log_message(std::string_view format, const Args&... args) {
 /*
 
 Example Usage:
-log_message("User {} has logged in from IP: {}", "Zelda", "192.168.1.100");
+LOG_INFO("User {} has logged in from IP: {}", "Zelda", "192.168.1.100");
+LOG_DEBUG("Accepted connection: FD {}", fd);   // compiled out unless VECTORDB_LOG_LEVEL <= 1
 log_message("File {} could not be found. Error code: {}", "config.yaml", 404);
 
 Output:
-[2025-03-06 18:05:12] main.cpp:5 - User Zelda has logged in from IP: 192.168.1.100
-[2025-03-06 18:05:12] main.cpp:6 - File config.yaml could not be found. Error code: 404
+[2025-03-06 18:05:12.417] INFO main.cpp:5 - User Zelda has logged in from IP: 192.168.1.100
+[2025-03-06 18:05:12.418] INFO main.cpp:7 - File config.yaml could not be found. Error code: 404
 
 */
-
@@ -3,6 +3,7 @@
 #include <cstdlib>       // std::size_t, std::stoi
 #include <csignal>       // std::signal, SIGINT
 #include <exception>     // std::exception
+#include <string_view>   // std::string_view
 #include "server.hpp"    // Server class
 
 Server* global_server = nullptr;
@@ -20,6 +21,11 @@ int main(int argc, char* argv[]) {
     try {
         uint16_t port = 1234; 
         size_t thread_pool_size = 4; 
+        IoBackend backend = IoBackend::Epoll;
+        size_t reactor_count = 1;
+        ConnectionLimits limits;
+        ExecutionMode execution = ExecutionMode::Inline;
+        MemoryLimits memory;
 
         if (argc > 1) {
             port = static_cast<uint16_t>(std::stoi(argv[1]));
@@ -35,8 +41,62 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         }
+        if (argc > 3) {
+            std::string_view name = argv[3];
+            if (name == "poll") {
+                backend = IoBackend::Poll;
+            } else if (name == "uring") {
+                backend = IoBackend::Uring;  // falls back to epoll if the kernel can't do it
+            } else if (name != "epoll") {
+                std::cerr << "Unknown I/O backend. Use 'poll', 'epoll' or 'uring'.\n";
+                return 1;
+            }
+        }
+        if (argc > 4) {
+            reactor_count = static_cast<size_t>(std::stoi(argv[4]));
+            if (reactor_count == 0) {
+                std::cerr << "Reactor count must be greater than 0.\n";
+                return 1;
+            }
+        }
+        if (argc > 5) {
+            size_t max_frame_kb = static_cast<size_t>(std::stoul(argv[5]));
+            if (max_frame_kb == 0 || max_frame_kb * 1024 > MAX_FRAME_SIZE + 1) {
+                std::cerr << "Max frame size must be between 1 and " << (MAX_FRAME_SIZE + 1) / 1024 << " KB.\n";
+                return 1;
+            }
+            limits.max_frame_size = std::min(max_frame_kb * 1024, MAX_FRAME_SIZE);
+        }
+        if (argc > 6) {
+            std::string_view name = argv[6];
+            if (name == "offload") {
+                execution = ExecutionMode::Offload;
+            } else if (name == "hybrid") {
+                execution = ExecutionMode::Hybrid;  // cheap commands (GET, SET, ...) stay on the reactor
+            } else if (name != "inline") {
+                std::cerr << "Unknown execution mode. Use 'inline', 'offload' or 'hybrid'.\n";
+                return 1;
+            }
+        }
+
+        if (argc > 7) {
+            memory.max_memory = static_cast<size_t>(std::stoull(argv[7])) * 1024 * 1024;  // 0 = unlimited
+        }
+        if (argc > 8) {
+            std::string_view name = argv[8];
+            if (name == "noeviction") {
+                memory.policy = EvictionPolicy::NoEviction;
+            } else if (name == "allkeys-lfu") {
+                memory.policy = EvictionPolicy::AllKeysLfu;
+            } else if (name == "volatile-ttl") {
+                memory.policy = EvictionPolicy::VolatileTtl;
+            } else if (name != "allkeys-lru") {
+                std::cerr << "Unknown eviction policy. Use 'noeviction', 'allkeys-lru', 'allkeys-lfu' or 'volatile-ttl'.\n";
+                return 1;
+            }
+        }
 
-        Server server(port, thread_pool_size);
+        Server server(port, thread_pool_size, backend, reactor_count, limits, execution, memory);
         global_server = &server; 
 
         auto result = server.initialize();
@@ -47,7 +107,8 @@ int main(int argc, char* argv[]) {
 
         std::signal(SIGINT, handle_signal);
 
-        std::cout << "Server running on port " << port << " with " << thread_pool_size << " threads.\n";
+        std::cout << "Server running on port " << server.port_ << " with " << thread_pool_size << " threads and "
+                  << reactor_count << " reactor(s).\n";
         server.run();
 
         return 0;
@@ -0,0 +1,198 @@
+#ifndef OFFLOAD_HPP
+#define OFFLOAD_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstring>
+#include <expected>
+#include <system_error>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "socket.hpp"
+#include "request_parser.hpp"
+#include "response_serializer.hpp"
+#include "command_processor.hpp"
+#include "entry_manager.hpp"
+#include "src/thread_pool.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+class Connection;
+
+// Where commands run. Inline executes everything on the reactor thread. Offload sends every command to the thread
+// pool so the reactor only does I/O, and Hybrid keeps the commands the handler table marks cheap (GET, SET, ...) inline
+// and offloads the rest, so one FLUSHALL or big ZSet operation no longer stalls every other connection on the reactor.
+enum class ExecutionMode : uint8_t {
+    Inline,
+    Offload,
+    Hybrid
+};
+
+static constexpr size_t MAX_OFFLOAD_BATCH = 256;  // commands per batch, the rest wait in rbuf_ for the next one
+
+// A run of consecutive requests from one connection. Arguments are copied in (rbuf_ keeps changing while a pool
+// thread works), the pool thread appends every reply to replies, and the reactor hands those to the connection's
+// output in one go. A connection has at most one batch out and runs nothing else meanwhile, so replies stay in order.
+struct OffloadBatch {
+    struct Command {
+        size_t first_arg;
+        size_t arg_count;
+        bool framed;    // binary frame, the reply gets a length prefix
+        bool streamed;  // last argument is streamed (see Connection::body_)
+    };
+
+    OffloadBatch(Connection* owner, ResponseFormat reply_format) : conn(owner), format(reply_format) {}
+
+    Connection* conn;
+    ResponseFormat format;                          // the connection's, a HELLO in the batch changes it for the rest
+    std::string bytes;                              // every argument back to back
+    std::vector<std::pair<size_t, size_t>> args;    // offset, length into bytes
+    std::vector<Command> commands;
+    std::string streamed;
+    std::vector<uint8_t> replies;
+    std::vector<ValueRef> refs;                     // at offsets into replies
+
+    [[nodiscard]] size_t size() const noexcept { return commands.size(); }
+
+    void add(const CommandArgs& command, bool framed, std::string* body) {
+        size_t copied = body ? command.size() - 1 : command.size();
+        commands.push_back({args.size(), command.size(), framed, body != nullptr});
+        for (size_t i = 0; i < copied; ++i) {
+            args.emplace_back(bytes.size(), command[i].size());
+            bytes.append(command[i]);
+        }
+        if (body) {
+            streamed = std::move(*body);
+        }
+    }
+
+    // pool thread
+    void execute(CommandProcessor& processor, EntryManager& entry_manager) {
+        for (const auto& command : commands) {
+            CommandArgs view;
+            for (size_t i = 0; i < command.arg_count - (command.streamed ? 1 : 0); ++i) {
+                auto [offset, len] = args[command.first_arg + i];
+                view.push_back(std::string_view(bytes).substr(offset, len));
+            }
+            if (command.streamed) {
+                view.push_back(streamed);
+            }
+
+            size_t start = replies.size();
+            size_t first_ref = refs.size();
+            if (command.framed) {
+                replies.resize(start + sizeof(uint32_t));
+            }
+            try {
+                CommandProcessor::CommandContext ctx{view, replies, entry_manager,
+                                                     command.streamed ? &streamed : nullptr, &refs, format, &format};
+                processor.process_command(ctx);
+            } catch (const std::exception&) {
+                replies.resize(command.framed ? start + sizeof(uint32_t) : start);
+                refs.resize(first_ref);
+                ResponseSerializer::serialize_error(replies, ERR_UNKNOWN, "internal error\n", format);
+            }
+            if (command.framed) {
+                size_t len = replies.size() - start - sizeof(uint32_t);
+                for (size_t i = first_ref; i < refs.size(); ++i) {
+                    len += refs[i].bytes.size();
+                }
+                uint32_t wlen = static_cast<uint32_t>(len);
+                std::memcpy(replies.data() + start, &wlen, sizeof(wlen));
+            }
+        }
+    }
+};
+
+// One per reactor. submit() hands a batch to the shared ThreadPool, the pool thread pushes it onto completed_ and
+// pokes an eventfd the reactor waits on next to its sockets, and drain() gives the batches back on the reactor thread.
+class Offloader {
+public:
+    Offloader(ExecutionMode mode, ThreadPool& pool, CommandProcessor& processor, EntryManager& entry_manager)
+        : mode_(mode), pool_(pool), processor_(processor), entry_manager_(entry_manager) {}
+
+    Offloader(const Offloader&) = delete;
+    Offloader& operator=(const Offloader&) = delete;
+
+    // batches still on the pool point at this queue, wait them out
+    ~Offloader() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_.wait(lock, [this] { return in_flight_ == 0; });
+    }
+
+    Result<void> initialize() {
+        event_fd_ = Socket(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+        if (event_fd_.get() < 0) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        return {};
+    }
+
+    [[nodiscard]] int fd() const noexcept { return event_fd_.get(); }
+    [[nodiscard]] ExecutionMode mode() const noexcept { return mode_; }
+
+    [[nodiscard]] bool wants(const CommandArgs& args) const noexcept {
+        return mode_ == ExecutionMode::Offload || (mode_ == ExecutionMode::Hybrid && CommandProcessor::is_slow(args));
+    }
+
+    void submit(std::unique_ptr<OffloadBatch> batch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            in_flight_++;
+        }
+        pool_.enqueue([this, raw = batch.release()] {
+            std::unique_ptr<OffloadBatch> done(raw);
+            done->execute(processor_, entry_manager_);
+            complete(std::move(done));
+        });
+    }
+
+    // reactor thread, after the eventfd became readable
+    template<typename F>
+    void drain(F&& on_complete) {
+        uint64_t count;
+        [[maybe_unused]] auto n = read(event_fd_.get(), &count, sizeof(count));  // reset before taking the queue
+
+        std::vector<std::unique_ptr<OffloadBatch>> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done.swap(completed_);
+        }
+        for (auto& batch : done) {
+            on_complete(std::move(batch));
+        }
+    }
+
+private:
+    ExecutionMode mode_;
+    ThreadPool& pool_;
+    CommandProcessor& processor_;
+    EntryManager& entry_manager_;
+    Socket event_fd_{-1};
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<OffloadBatch>> completed_;
+    size_t in_flight_{0};
+    std::condition_variable drained_;
+
+    // Only a push onto an empty queue has to wake the reactor, it takes everything queued once it runs.
+    // All of it under the lock so the destructor can't return while a pool thread still touches this.
+    void complete(std::unique_ptr<OffloadBatch> batch) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (completed_.empty()) {
+            uint64_t one = 1;
+            [[maybe_unused]] auto n = write(event_fd_.get(), &one, sizeof(one));
+        }
+        completed_.push_back(std::move(batch));
+        if (--in_flight_ == 0) {
+            drained_.notify_all();
+        }
+    }
+};
+
+#endif // OFFLOAD_HPP
@@ -0,0 +1,120 @@
+#ifndef OUTPUT_QUEUE_HPP
+#define OUTPUT_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <sys/uio.h>
+#include "response_serializer.hpp"
+#include "src/ring_buffer.hpp"
+
+// A connection's outgoing bytes: small reply bytes are copied into a ring, large values are queued by reference
+// (ValueRef) and go to the socket straight from the entry that owns them. Order is preserved by remembering how
+// many ring bytes precede each reference. gather() turns the front of the queue into iovecs for one sendmsg.
+class OutputQueue {
+public:
+    explicit OutputQueue(size_t initial_capacity = 4096) : bytes_(initial_capacity) {}
+
+    OutputQueue(const OutputQueue&) = delete;
+    OutputQueue& operator=(const OutputQueue&) = delete;
+    OutputQueue(OutputQueue&&) noexcept = default;
+    OutputQueue& operator=(OutputQueue&&) noexcept = default;
+
+    [[nodiscard]] size_t size() const noexcept { return bytes_.size() + referenced_; }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    void append(const void* src, size_t n) { bytes_.append(src, n); }
+    void append(std::span<const uint8_t> bytes) { bytes_.append(bytes); }
+
+    // a serialized reply plus the values it references, refs[i].at being offsets into reply
+    void append(std::span<const uint8_t> reply, std::vector<ValueRef>& refs) {
+        size_t copied = 0;
+        for (auto& ref : refs) {
+            bytes_.append(reply.subspan(copied, ref.at - copied));
+            copied = ref.at;
+            slices_.push_back({bytes_.size() - ring_before_slices_, std::move(ref.owner),
+                               reinterpret_cast<const uint8_t*>(ref.bytes.data()), ref.bytes.size()});
+            ring_before_slices_ = bytes_.size();
+            referenced_ += ref.bytes.size();
+        }
+        bytes_.append(reply.subspan(copied));
+    }
+
+    // fills up to max iovecs from the front of the queue, returns how many
+    int gather(iovec* iov, int max) noexcept {
+        iovec ring[2];
+        int ring_count = bytes_.readable(ring);
+        int ring_index = 0;
+        int n = 0;
+
+        auto take_ring = [&](size_t len) {
+            while (len > 0 && n < max && ring_index < ring_count) {
+                size_t chunk = std::min(len, ring[ring_index].iov_len);
+                iov[n++] = {ring[ring_index].iov_base, chunk};
+                ring[ring_index].iov_base = static_cast<uint8_t*>(ring[ring_index].iov_base) + chunk;
+                ring[ring_index].iov_len -= chunk;
+                if (ring[ring_index].iov_len == 0) {
+                    ++ring_index;
+                }
+                len -= chunk;
+            }
+        };
+
+        for (const auto& slice : slices_) {
+            take_ring(slice.ring_before);
+            if (n == max) {
+                return n;
+            }
+            iov[n++] = {const_cast<uint8_t*>(slice.data), slice.len};
+            if (n == max) {
+                return n;
+            }
+        }
+        take_ring(bytes_.size() - ring_before_slices_);
+        return n;
+    }
+
+    // drops n sent bytes from the front, releasing each referenced value once it is fully on the wire
+    void consume(size_t n) noexcept {
+        while (n > 0 && !slices_.empty()) {
+            Slice& front = slices_.front();
+            size_t from_ring = std::min(n, front.ring_before);
+            bytes_.consume(from_ring);
+            front.ring_before -= from_ring;
+            ring_before_slices_ -= from_ring;
+            n -= from_ring;
+
+            size_t from_slice = std::min(n, front.len);
+            front.data += from_slice;
+            front.len -= from_slice;
+            referenced_ -= from_slice;
+            n -= from_slice;
+
+            if (front.ring_before == 0 && front.len == 0) {
+                slices_.pop_front();
+            } else {
+                return;
+            }
+        }
+        bytes_.consume(n);
+    }
+
+private:
+    struct Slice {
+        size_t ring_before;  // ring bytes between the previous slice (or the front) and this one
+        std::shared_ptr<const void> owner;
+        const uint8_t* data;
+        size_t len;
+    };
+
+    RingBuffer bytes_;
+    std::deque<Slice> slices_;
+    size_t ring_before_slices_{0};  // ring bytes that sit in front of the last slice
+    size_t referenced_{0};
+};
+
+#endif // OUTPUT_QUEUE_HPP
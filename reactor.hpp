@@ -0,0 +1,647 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <algorithm>
+#include <memory>         
+#include <vector>         
+#include <unordered_map>  
+#include <cstdint>        
+#include <expected>      
+#include <system_error>   
+#include <poll.h>     
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <atomic>
+#include "socket.hpp"
+#include "connection.hpp"
+#include "command_processor.hpp"
+#include "entry_manager.hpp"
+#include "uring.hpp"
+#include "offload.hpp"
+#include "logging.hpp"
+#include "src/timer_wheel.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+// Poll rebuilds a pollfd per connection on every wakeup (O(connections)), Epoll keeps the
+// interest set in the kernel and only hands back ready fds (O(ready)). Uring is completion based:
+// multishot accept/recv stay armed and every queued send goes out in the one io_uring_enter per loop.
+enum class IoBackend : uint8_t {
+    Poll,
+    Epoll,
+    Uring
+};
+
+static constexpr auto IDLE_TIMER_TICK = std::chrono::milliseconds(100);  // idle deadlines are rounded up to this
+static constexpr size_t IDLE_TIMER_SLOTS = 128;                          // one lap covers 12.8s, longer just re-hash
+static constexpr size_t MAX_EPOLL_EVENTS = 256;
+static constexpr unsigned URING_ENTRIES = 1024;
+static constexpr unsigned URING_BUFFER_COUNT = 512;  // must be a power of two
+static constexpr unsigned URING_BUFFER_SIZE = 4096;
+
+// A reactor is one event loop thread: it owns its listener, its connection table and its idle timers,
+// and nothing in here is shared with other reactors. Only the EntryManager is shared (see CommandProcessor).
+class Reactor {
+public:
+    uint16_t port_;
+    IoBackend backend_;
+    bool reuse_port_;
+    Socket listen_socket_{-1};
+    Socket epoll_fd_{-1};
+    EntryManager& entry_manager_;
+    CommandProcessor& command_processor_;
+    const std::atomic<bool>& should_stop_;
+    ConnectionLimits limits_;
+    ExecutionMode execution_;
+    ThreadPool* pool_;
+
+    Reactor(uint16_t port, IoBackend backend, bool reuse_port, EntryManager& entry_manager,
+            CommandProcessor& command_processor, const std::atomic<bool>& should_stop, ConnectionLimits limits = {},
+            ExecutionMode execution = ExecutionMode::Inline, ThreadPool* pool = nullptr)
+        : port_(port), backend_(backend), reuse_port_(reuse_port), entry_manager_(entry_manager),
+          command_processor_(command_processor), should_stop_(should_stop), limits_(limits),
+          execution_(pool ? execution : ExecutionMode::Inline), pool_(pool) {}
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    Result<void> initialize();
+    void run();
+    void shutdown_listener();
+
+    // one iteration of the event loop, exposed so the loops can be driven (and benchmarked) directly
+    void poll_once(int timeout_ms);
+    void epoll_once(int timeout_ms);
+    void uring_once(int timeout_ms);
+
+    [[nodiscard]] uint16_t port() const noexcept { return port_; }
+
+    std::unique_ptr<Offloader> offloader_;  // null in ExecutionMode::Inline
+    TimerWheel<Connection> idle_timers_{IDLE_TIMER_TICK, IDLE_TIMER_SLOTS};  // declared first, outlives the nodes
+    std::chrono::steady_clock::time_point loop_now_{std::chrono::steady_clock::now()};  // once per wakeup
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::vector<pollfd> poll_args_;
+    std::vector<epoll_event> epoll_events_;
+    std::unique_ptr<IoUring> uring_;  // declared after connections_ so the ring is torn down before them
+
+    Result<Socket> create_listen_socket();
+    Result<Socket> create_epoll();
+    void prepare_poll_args(std::vector<pollfd>& poll_args);
+    int calculate_next_timeout();
+    void process_active_connections(const std::vector<pollfd>& poll_args);
+    void process_connection(Connection& conn);
+    void touch(Connection& conn);
+    void process_timers(bool idle);
+    void accept_new_connections();
+    void add_connection(std::unique_ptr<Connection> conn);
+    void remove_connection(int fd);
+    Result<void> update_interest(Connection& conn, int op);
+    void reap(Connection& conn);
+    void drain_completions();
+    void complete_batch(std::unique_ptr<OffloadBatch> batch);
+
+    void handle_completion(const io_uring_cqe& cqe);
+    void uring_arm_recv(Connection& conn);
+    void uring_flush(Connection& conn);
+    void uring_send(Connection& conn);
+    void uring_close(Connection& conn);
+};
+
+inline Result<void> Reactor::initialize() {
+    auto listen_result = create_listen_socket();
+    if (!listen_result) {
+        return std::unexpected(listen_result.error());
+    }
+
+    listen_socket_ = std::move(*listen_result);
+
+    if (execution_ != ExecutionMode::Inline) {
+        offloader_ = std::make_unique<Offloader>(execution_, *pool_, command_processor_, entry_manager_);
+        auto offload_result = offloader_->initialize();
+        if (!offload_result) {
+            return std::unexpected(offload_result.error());
+        }
+    }
+
+    if (backend_ == IoBackend::Uring) {
+        auto ring = IoUring::create(URING_ENTRIES, URING_BUFFER_COUNT, URING_BUFFER_SIZE);
+        if (ring) {
+            uring_ = std::move(*ring);
+            uring_->prep_multishot_accept(listen_socket_.get(), encode_user_data(this, UringOp::Accept));
+            if (offloader_) {
+                uring_->prep_multishot_poll(offloader_->fd(), encode_user_data(offloader_.get(), UringOp::Wakeup));
+            }
+            return {};
+        }
+        LOG_WARN("io_uring unavailable ({}), falling back to epoll", ring.error().message());
+        backend_ = IoBackend::Epoll;
+    }
+
+    if (backend_ == IoBackend::Epoll) {
+        auto epoll_result = create_epoll();
+        if (!epoll_result) {
+            return std::unexpected(epoll_result.error());
+        }
+        epoll_fd_ = std::move(*epoll_result);
+    }
+    return {};
+}
+
+inline Result<Socket> Reactor::create_listen_socket() {
+    Socket sock(socket(AF_INET, SOCK_STREAM, 0));
+    if (sock.get() < 0) {
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(std::errc::bad_file_descriptor));
+    }
+
+    int val = 1;
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val)) < 0) {
+        LOG_ERROR("setsockopt failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    // every reactor binds its own listener to the same port and the kernel hashes incoming connections across them
+    if (reuse_port_ && setsockopt(sock.get(), SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) < 0) {
+        LOG_ERROR("setsockopt(SO_REUSEPORT) failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    inet_pton(AF_INET, "0.0.0.0", &addr.sin_addr);
+
+    if (bind(sock.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        LOG_ERROR("Bind failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(std::errc::address_in_use));
+    }
+
+    if (listen(sock.get(), SOMAXCONN) < 0) {
+        LOG_ERROR("Listen failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(std::errc::connection_refused));
+    }
+
+    auto result = sock.set_nonblocking();
+    if (!result) {
+        return std::unexpected(result.error());
+    }
+
+    // port 0 asks the kernel for an ephemeral port, remember it so sibling reactors can share it
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(sock.get(), reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    }
+
+    LOG_INFO("Reactor listening on port {}", port_);
+    return sock;
+}
+
+// the listen socket is registered with a null data.ptr and the offload eventfd with the Offloader, so epoll_once
+// can tell both apart from connections
+inline Result<Socket> Reactor::create_epoll() {
+    Socket epfd(epoll_create1(EPOLL_CLOEXEC));
+    if (epfd.get() < 0) {
+        LOG_ERROR("epoll_create1 failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = nullptr;
+    if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, listen_socket_.get(), &ev) < 0) {
+        LOG_ERROR("epoll_ctl(listen) failed: {}", strerror(errno));
+        return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+    }
+
+    if (offloader_) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = offloader_.get();
+        if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, offloader_->fd(), &ev) < 0) {
+            LOG_ERROR("epoll_ctl(eventfd) failed: {}", strerror(errno));
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+    }
+
+    epoll_events_.resize(MAX_EPOLL_EVENTS);
+    return epfd;
+}
+
+// edge-triggered, so this is only called when a connection flips between Request and Response
+inline Result<void> Reactor::update_interest(Connection& conn, int op) {
+    epoll_event ev{};
+    ev.events = (conn.state() == ConnectionState::Response ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn;
+    if (epoll_ctl(epoll_fd_.get(), op, conn.fd(), &ev) < 0) {
+        return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+    }
+    return {};
+}
+
+
+// [0] is the listener, [1] the offload eventfd when there is one. A connection with a batch out is not read
+// until it comes back (level-triggered, POLLIN would just spin), one that is closing is left out.
+inline void Reactor::prepare_poll_args(std::vector<pollfd>& poll_args) {
+    poll_args.clear();
+    poll_args.push_back({listen_socket_.get(), POLLIN, 0});
+    if (offloader_) {
+        poll_args.push_back({offloader_->fd(), POLLIN, 0});
+    }
+
+    for (const auto& [fd, conn] : connections_) {
+        if (conn->closing_) continue;
+        short events = conn->state() == ConnectionState::Request ? POLLIN : POLLOUT;
+        poll_args.push_back({fd, conn->offloaded_ ? short{0} : events, 0});
+    }
+}
+
+// until the next idle timer slot, key expiry or rehash cycle is due, whichever comes first
+inline int Reactor::calculate_next_timeout() {
+    auto now = std::chrono::steady_clock::now();
+    auto next = std::min(entry_manager_.next_expire_timeout(now), entry_manager_.next_rehash_timeout(now));
+    if (auto idle = idle_timers_.next_timeout(now)) {
+        next = std::min(next, *idle);
+    }
+    return static_cast<int>(next.count());
+}
+
+inline void Reactor::process_active_connections(const std::vector<pollfd>& poll_args) {
+    for (size_t i = offloader_ ? 2 : 1; i < poll_args.size(); ++i) {
+        if (poll_args[i].revents == 0) continue;
+
+        auto it = connections_.find(poll_args[i].fd);
+        if (it == connections_.end()) continue;
+
+        process_connection(*it->second);
+    }
+}
+
+// may destroy conn, callers must not touch it afterwards
+inline void Reactor::process_connection(Connection& conn) {
+    LOG_TRACE("Processing connection: FD {}", conn.fd());
+
+    ConnectionState before = conn.state();
+    touch(conn);
+    try {
+        auto result = conn.process_io();
+        if (!result || conn.state() == ConnectionState::End) {
+            LOG_DEBUG("Closing connection: FD {}", conn.fd());
+            remove_connection(conn.fd());
+            return;
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("Connection error: {}", e.what());
+        remove_connection(conn.fd());
+        return;
+    }
+
+    if (backend_ == IoBackend::Epoll && conn.state() != before) {
+        if (!update_interest(conn, EPOLL_CTL_MOD)) {
+            remove_connection(conn.fd());
+        }
+    }
+}
+
+// any progress counts as activity. O(1): the deadline only moves later, the wheel re-hashes the node
+// when it reaches its old slot
+inline void Reactor::touch(Connection& conn) {
+    idle_timers_.touch(conn.idle_timer_, loop_now_ + conn.limits_.idle_timeout);
+}
+
+// runs after the wakeup's events, so a connection that was just touched is re-hashed rather than closed.
+// Every connection whose slot came due with no activity since goes in one pass, no scan of connections_.
+// idle: the wakeup was a timeout with no events, so the keyspace's resize work gets the bigger budget.
+inline void Reactor::process_timers(bool idle) {
+    size_t expired = idle_timers_.advance(loop_now_, [this](Connection& conn) { remove_connection(conn.fd()); });
+    if (expired > 0) {
+        LOG_DEBUG("Closed {} idle connection(s)", expired);
+    }
+    entry_manager_.run_expire_cycle(loop_now_);
+    entry_manager_.run_rehash_cycle(loop_now_, idle);
+}
+
+inline void Reactor::accept_new_connections() {
+    while (true) {
+        sockaddr_in client_addr{};
+        socklen_t addr_len = sizeof(client_addr);
+        int client_fd = accept(listen_socket_.get(), reinterpret_cast<sockaddr*>(&client_addr), &addr_len);
+
+        if (client_fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                LOG_TRACE("No more pending connections");
+                break;
+            } else {
+                LOG_ERROR("Accept failed: {}", strerror(errno));
+                break;
+            }
+        }
+
+        LOG_DEBUG("Accepted connection from {}:{}", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        
+        try {
+            Socket client_socket(client_fd);
+            auto result = client_socket.set_nonblocking();
+            if (!result) {
+                LOG_ERROR("Failed to set nonblocking socket");
+                continue;
+            }
+
+            auto conn = std::make_unique<Connection>(
+                std::move(client_socket),
+                entry_manager_,
+                command_processor_,
+                limits_,
+                offloader_.get()
+            );
+
+            add_connection(std::move(conn));
+        } catch (...) {
+            close(client_fd);
+        }
+    }
+}
+
+inline void Reactor::add_connection(std::unique_ptr<Connection> conn) {
+    if (backend_ == IoBackend::Epoll) {
+        auto result = update_interest(*conn, EPOLL_CTL_ADD);
+        if (!result) {
+            LOG_ERROR("epoll_ctl(add) failed: {}", result.error().message());
+            return;
+        }
+    }
+    int fd = conn->fd();
+    auto [it, inserted] = connections_.emplace(fd, std::move(conn));
+    if (!inserted) {
+        return;
+    }
+    touch(*it->second);
+    if (backend_ == IoBackend::Uring) {
+        uring_arm_recv(*it->second);
+    }
+}
+
+inline void Reactor::remove_connection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+    Connection& conn = *it->second;
+    if (backend_ == IoBackend::Uring) {
+        uring_close(conn);
+    } else if (!conn.closing_) {
+        conn.closing_ = true;
+        idle_timers_.cancel(conn.idle_timer_);
+        if (backend_ == IoBackend::Epoll) {
+            epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+    reap(conn);
+}
+
+// frees a closing connection once nothing (SQE, offloaded batch) refers to it any more.
+// May destroy conn, callers must not touch it afterwards.
+inline void Reactor::reap(Connection& conn) {
+    if (conn.closing_ && conn.pending_ops_ == 0) {
+        connections_.erase(conn.fd());
+    }
+}
+
+inline void Reactor::poll_once(int timeout_ms) {
+    prepare_poll_args(poll_args_);
+    LOG_TRACE("Polling for activity...");
+    int ret = poll(poll_args_.data(), poll_args_.size(), timeout_ms);  
+
+    if (should_stop_) return;
+    loop_now_ = std::chrono::steady_clock::now();
+    entry_manager_.update_lru_clock(loop_now_);
+
+    if (ret > 0) {
+        LOG_TRACE("Poll detected activity");
+        if (poll_args_[0].revents & POLLIN) {
+            accept_new_connections();
+        }
+        process_active_connections(poll_args_);
+        if (offloader_ && poll_args_[1].revents) {
+            drain_completions();
+        }
+    }
+    process_timers(ret == 0);
+}
+
+// data.ptr carries the Connection*, so a wakeup costs O(ready fds) with no table lookup.
+// Inside the loop a connection is only freed while handling its own event, so later pointers in the batch stay
+// valid. A returning offload batch can free its connection too, so completions are drained after the loop
+// (like poll_once does) rather than where the eventfd shows up in the batch.
+inline void Reactor::epoll_once(int timeout_ms) {
+    int ret;
+    do {
+        ret = epoll_wait(epoll_fd_.get(), epoll_events_.data(), static_cast<int>(epoll_events_.size()), timeout_ms);
+    } while (ret < 0 && errno == EINTR && !should_stop_);
+
+    if (should_stop_) return;
+    loop_now_ = std::chrono::steady_clock::now();
+    entry_manager_.update_lru_clock(loop_now_);
+
+    bool completions = false;
+    for (int i = 0; i < ret; ++i) {
+        void* ptr = epoll_events_[i].data.ptr;
+        if (!ptr) {
+            accept_new_connections();
+            continue;
+        }
+        if (ptr == offloader_.get()) {
+            completions = true;
+            continue;
+        }
+        auto* conn = static_cast<Connection*>(ptr);
+        if (!conn->closing_) {
+            process_connection(*conn);
+        }
+    }
+    if (completions) {
+        drain_completions();
+    }
+    process_timers(ret == 0);
+}
+
+// Every SQE queued while handling the previous batch (sends, re-armed recvs, accepts) is submitted by the
+// same io_uring_enter that waits for the next batch.
+inline void Reactor::uring_once(int timeout_ms) {
+    auto result = uring_->submit_and_wait(timeout_ms);
+    if (!result) {
+        LOG_ERROR("io_uring_enter failed: {}", result.error().message());
+        return;
+    }
+    loop_now_ = std::chrono::steady_clock::now();
+    entry_manager_.update_lru_clock(loop_now_);
+    unsigned seen = uring_->for_each_cqe([this](const io_uring_cqe& cqe) { handle_completion(cqe); });
+    process_timers(seen == 0);
+}
+
+inline void Reactor::handle_completion(const io_uring_cqe& cqe) {
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    switch (decode_op(cqe.user_data)) {
+    case UringOp::Wakeup:
+        drain_completions();
+        if (!more && !should_stop_) {
+            uring_->prep_multishot_poll(offloader_->fd(), encode_user_data(offloader_.get(), UringOp::Wakeup));
+        }
+        break;
+
+    case UringOp::Accept:
+        if (cqe.res >= 0) {
+            add_connection(std::make_unique<Connection>(Socket(cqe.res), entry_manager_, command_processor_, limits_,
+                                                        offloader_.get()));
+        } else if (cqe.res != -ECANCELED && !should_stop_) {
+            LOG_ERROR("Accept failed: {}", strerror(-cqe.res));
+        }
+        if (!more && !should_stop_) {
+            uring_->prep_multishot_accept(listen_socket_.get(), encode_user_data(this, UringOp::Accept));
+        }
+        break;
+
+    case UringOp::Recv: {
+        Connection& conn = *decode_ptr<Connection>(cqe.user_data);
+        if (!more) {
+            conn.pending_ops_--;
+        }
+
+        if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+            auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (!conn.closing_) {
+                touch(conn);
+                auto data = uring_->buffer(bid, static_cast<size_t>(cqe.res));
+                conn.rbuf_.append(data);
+                if (!conn.process_requests()) {
+                    uring_close(conn);
+                }
+            }
+            uring_->recycle_buffer(bid);
+            if (!more && !conn.closing_) {
+                uring_arm_recv(conn);
+            }
+            uring_flush(conn);
+        } else if (cqe.res == -ENOBUFS) {
+            // every provided buffer was in use, they have been recycled by the time we get here
+            if (!more && !conn.closing_) {
+                uring_arm_recv(conn);
+            }
+        } else {
+            uring_close(conn);  // EOF or error
+        }
+        reap(conn);
+        break;
+    }
+
+    case UringOp::Send: {
+        Connection& conn = *decode_ptr<Connection>(cqe.user_data);
+        conn.pending_ops_--;
+
+        if (cqe.res <= 0) {
+            uring_close(conn);
+        } else {
+            if (!conn.closing_) {
+                touch(conn);  // a client slowly draining a big reply is not idle
+            }
+            conn.inflight_.consume(static_cast<size_t>(cqe.res));
+            if (!conn.inflight_.empty() && !conn.closing_) {
+                uring_send(conn);  // partial send, or more than MAX_SEND_IOVECS segments
+            } else {
+                if (conn.held_back_ && !conn.closing_ && !conn.process_requests()) {
+                    uring_close(conn);  // the output cap had parked requests in rbuf_, run them now it drained
+                }
+                uring_flush(conn);
+            }
+        }
+        reap(conn);
+        break;
+    }
+    }
+}
+
+inline void Reactor::uring_arm_recv(Connection& conn) {
+    uring_->prep_multishot_recv(conn.fd(), encode_user_data(&conn, UringOp::Recv));
+    conn.pending_ops_++;
+}
+
+// inflight_ is non-empty exactly while a send SQE is outstanding, replies produced meanwhile wait in wbuf_
+inline void Reactor::uring_flush(Connection& conn) {
+    if (conn.closing_ || !conn.inflight_.empty() || conn.wbuf_.empty()) {
+        return;
+    }
+
+    std::swap(conn.inflight_, conn.wbuf_);  // the kernel reads from the swapped-out queue, wbuf_ keeps taking replies
+    uring_send(conn);
+}
+
+inline void Reactor::uring_send(Connection& conn) {
+    conn.send_msg_ = {};
+    conn.send_msg_.msg_iov = conn.send_iov_;
+    conn.send_msg_.msg_iovlen = static_cast<size_t>(conn.inflight_.gather(conn.send_iov_, MAX_SEND_IOVECS));
+    uring_->prep_sendmsg(conn.fd(), &conn.send_msg_, encode_user_data(&conn, UringOp::Send));
+    conn.pending_ops_++;
+}
+
+// shutdown makes the armed recv complete with EOF and fails any send, so every outstanding SQE comes back
+inline void Reactor::uring_close(Connection& conn) {
+    if (!conn.closing_) {
+        conn.closing_ = true;
+        idle_timers_.cancel(conn.idle_timer_);
+        ::shutdown(conn.fd(), SHUT_RDWR);
+    }
+}
+
+// every batch a pool thread finished since the last wakeup
+inline void Reactor::drain_completions() {
+    offloader_->drain([this](std::unique_ptr<OffloadBatch> batch) { complete_batch(std::move(batch)); });
+}
+
+// Appends the batch's replies in one go and picks the connection up where it stopped: anything that arrived
+// meanwhile is run (or batched again) and everything is flushed, as if the socket had just turned readable.
+inline void Reactor::complete_batch(std::unique_ptr<OffloadBatch> batch) {
+    Connection& conn = *batch->conn;
+    conn.offloaded_ = false;
+    conn.pending_ops_--;
+    if (conn.closing_) {
+        reap(conn);
+        return;
+    }
+
+    conn.format_ = batch->format;
+    conn.wbuf_.append(batch->replies, batch->refs);
+    if (backend_ != IoBackend::Uring) {
+        process_connection(conn);
+        return;
+    }
+    touch(conn);
+    if (!conn.process_requests()) {
+        uring_close(conn);
+    }
+    uring_flush(conn);
+    reap(conn);
+}
+
+inline void Reactor::run() {
+    while (!should_stop_) {
+        int timeout_ms = calculate_next_timeout();
+        if (backend_ == IoBackend::Uring) {
+            uring_once(timeout_ms);
+        } else if (backend_ == IoBackend::Epoll) {
+            epoll_once(timeout_ms);
+        } else {
+            poll_once(timeout_ms);
+        }
+    }
+}
+
+// shutdown rather than close: the Socket still owns the fd and closes it exactly once
+inline void Reactor::shutdown_listener() {
+    if (listen_socket_.get() != -1) {
+        ::shutdown(listen_socket_.get(), SHUT_RDWR);
+    }
+}
+
+#endif // REACTOR_HPP
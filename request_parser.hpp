@@ -8,10 +8,37 @@
 #include <expected>     // For std::expected (C++23)
 #include <system_error> // For std::error_code, std::errc, std::make_error_code
 #include <cstring>      // For std::memcpy
+#include <string_view>  // For std::string_view
+#include <array>        // For std::array
  
 template<typename T>
 using Result = std::expected<T, std::error_code>;
 
+static constexpr size_t MAX_ARGS = 64;
+
+// The arguments of one request as views into the connection's read buffer: no allocation, no copy.
+// Only valid until the frame they came from is consumed, anything that outlives the command must copy.
+class CommandArgs {
+public:
+    bool push_back(std::string_view arg) noexcept {
+        if (count_ == MAX_ARGS) {
+            return false;
+        }
+        args_[count_++] = arg;
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+    [[nodiscard]] std::string_view operator[](size_t i) const noexcept { return args_[i]; }
+    [[nodiscard]] const std::string_view* begin() const noexcept { return args_.data(); }
+    [[nodiscard]] const std::string_view* end() const noexcept { return args_.data() + count_; }
+
+private:
+    std::array<std::string_view, MAX_ARGS> args_{};
+    size_t count_{0};
+};
+
 // request parser class responsible for parsing incoming data into command components
 class RequestParser {
     public:
@@ -53,7 +80,7 @@ class RequestParser {
         
             while (pos < end) {
         
-                if (end - pos < sizeof(uint32_t)) {
+                if (static_cast<size_t>(end - pos) < sizeof(uint32_t)) {
                     return std::unexpected(std::make_error_code(std::errc::bad_message));
                 }
         
@@ -75,6 +102,67 @@ class RequestParser {
         
             return cmd;
         }
+
+        // Same frame format as parse, but the arguments are views into data instead of copies.
+        static Result<CommandArgs> parse_views(std::span<const uint8_t> data) {
+            if (data.size() < sizeof(uint32_t)) {
+                return std::unexpected(std::make_error_code(std::errc::message_size));
+            }
+
+            uint32_t len;
+            std::memcpy(&len, data.data(), sizeof(uint32_t));
+            len = __builtin_bswap32(len);
+
+            if (sizeof(uint32_t) + len > data.size()) {
+                return std::unexpected(std::make_error_code(std::errc::message_size));
+            }
+
+            CommandArgs args;
+            const uint8_t* pos = data.data() + sizeof(uint32_t);
+            const uint8_t* end = pos + len;
+
+            while (pos < end) {
+                if (static_cast<size_t>(end - pos) < sizeof(uint32_t)) {
+                    return std::unexpected(std::make_error_code(std::errc::bad_message));
+                }
+
+                uint32_t str_len;
+                std::memcpy(&str_len, pos, sizeof(uint32_t));
+                pos += sizeof(uint32_t);
+                str_len = __builtin_bswap32(str_len);
+
+                if (str_len > static_cast<uint32_t>(end - pos)) {
+                    return std::unexpected(std::make_error_code(std::errc::bad_message));
+                }
+                if (!args.push_back(std::string_view(reinterpret_cast<const char*>(pos), str_len))) {
+                    return std::unexpected(std::make_error_code(std::errc::argument_list_too_long));
+                }
+                pos += str_len;
+            }
+
+            return args;
+        }
+
+        // Splits an inline text command ("SET key value") on spaces/tabs, again as views into line.
+        static Result<CommandArgs> parse_inline(std::string_view line) {
+            CommandArgs args;
+            size_t pos = 0;
+            while (pos < line.size()) {
+                pos = line.find_first_not_of(" \t\r", pos);
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+                size_t end = line.find_first_of(" \t\r", pos);
+                if (end == std::string_view::npos) {
+                    end = line.size();
+                }
+                if (!args.push_back(line.substr(pos, end - pos))) {
+                    return std::unexpected(std::make_error_code(std::errc::argument_list_too_long));
+                }
+                pos = end;
+            }
+            return args;
+        }
         
 };
 
@@ -6,23 +6,39 @@
 #include <string_view>  
 #include <cstring>      
 #include <string>      
+#include <memory>
+#include <optional>
+#include <span>
+#include <charconv>
 
 #include "common.hpp"
+#include "logging.hpp"
+
+// values at least this big are referenced by the reply instead of copied into it, below it memcpy is cheaper
+static constexpr size_t ZERO_COPY_MIN = 4096;
+
+// A stored value spliced into a reply at byte offset `at` without copying. owner keeps the bytes alive until
+// they have been written to the socket, stored values are never mutated in place so the view stays valid.
+struct ValueRef {
+    size_t at;
+    std::shared_ptr<const void> owner;
+    std::string_view bytes;
+};
 
 class ResponseSerializer {
 public:
     template<typename T>
-    static void serialize(std::vector<uint8_t>& buffer, const T& data) {
+    static void serialize(std::vector<uint8_t>& buffer, const T& data, ResponseFormat format = ResponseFormat::V1) {
         constexpr SerializationType type = get_serialization_type<T>();
         
         if constexpr (type == SerializationType::Nil) {
             serialize_nil(buffer);
         } else if constexpr (type == SerializationType::Integer) {
-            serialize_integer(buffer, static_cast<int64_t>(data));
+            serialize_integer(buffer, static_cast<int64_t>(data), format);
         } else if constexpr (type == SerializationType::Double) {
             serialize_double(buffer, static_cast<double>(data));
         } else if constexpr (type == SerializationType::String) {
-            serialize_string(buffer, data);
+            serialize_string(buffer, data, format);
         } else {
             static_assert("Unsupported type for serialization");
         }
@@ -32,23 +48,54 @@ public:
         buffer.push_back(static_cast<uint8_t>(SerializationType::Nil));
     }
 
-    static void serialize_error(std::vector<uint8_t>& buffer, int32_t code, std::string_view msg) {
+    static void serialize_error(std::vector<uint8_t>& buffer, int32_t code, std::string_view msg,
+                                ResponseFormat format = ResponseFormat::V1) {
         buffer.push_back(static_cast<uint8_t>(SerializationType::Error));
-        append_data(buffer, code);
-        append_data(buffer, static_cast<uint32_t>(msg.size()));
+        if (format == ResponseFormat::V2) {
+            append_varint(buffer, zigzag(code));
+        } else {
+            append_data(buffer, code);
+        }
+        append_length(buffer, msg.size(), format);
         buffer.insert(buffer.end(), msg.begin(), msg.end());
     }
 
-    static void serialize_string(std::vector<uint8_t>& buffer, std::string_view str) {
+    // short text replies (OK, field names), see serialize_bulk for stored values
+    static void serialize_string(std::vector<uint8_t>& buffer, std::string_view str, ResponseFormat format = ResponseFormat::V1) {
         buffer.push_back(static_cast<uint8_t>(SerializationType::String));
-        append_data(buffer, static_cast<uint32_t>(str.size()));
+        append_length(buffer, str.size(), format);
         buffer.insert(buffer.end(), str.begin(), str.end());
     }
 
-    static void serialize_integer(std::vector<uint8_t>& buffer, int64_t value) {
+    static void serialize_bulk(std::vector<uint8_t>& buffer, std::string_view bytes, ResponseFormat format = ResponseFormat::V1) {
+        buffer.push_back(static_cast<uint8_t>(bulk_type(format)));
+        append_length(buffer, bytes.size(), format);
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    }
+
+    // same wire format as serialize_bulk, but large bytes go out by reference when the caller collects refs. The
+    // owner is only copied (pinned) when it actually goes by reference, a small value never touches its refcount.
+    template<typename Owner>
+    static void serialize_bulk_ref(std::vector<uint8_t>& buffer, std::vector<ValueRef>* refs, const std::shared_ptr<Owner>& owner,
+                                   std::string_view bytes, ResponseFormat format = ResponseFormat::V1) {
+        if (!refs || bytes.size() < ZERO_COPY_MIN) {
+            return serialize_bulk(buffer, bytes, format);
+        }
+        buffer.push_back(static_cast<uint8_t>(bulk_type(format)));
+        append_length(buffer, bytes.size(), format);
+        refs->push_back({buffer.size(), owner, bytes});
+    }
+
+    static void serialize_integer(std::vector<uint8_t>& buffer, int64_t value, ResponseFormat format = ResponseFormat::V1) {
         buffer.push_back(static_cast<uint8_t>(SerializationType::Integer));
-        std::string str_value = std::to_string(value) + "\r\n";  // Convert integer to string format
-        buffer.insert(buffer.end(), str_value.begin(), str_value.end());
+        if (format == ResponseFormat::V2) {
+            return append_varint(buffer, zigzag(value));
+        }
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        buffer.insert(buffer.end(), digits, end);
+        buffer.push_back('\r');
+        buffer.push_back('\n');
     }
 
     static void serialize_double(std::vector<uint8_t>& buffer, double value) {
@@ -56,51 +103,135 @@ public:
         append_data(buffer, value);
     }
 
-    static std::string deserialize_string(const std::vector<uint8_t>& buffer) {
-        if (buffer.empty() || buffer[0] != static_cast<uint8_t>(SerializationType::String)) {
+    // an aggregate is just its header followed by the elements, written with the other serialize_* calls
+    static void serialize_array_header(std::vector<uint8_t>& buffer, size_t count, ResponseFormat format = ResponseFormat::V1) {
+        buffer.push_back(static_cast<uint8_t>(SerializationType::Array));
+        append_length(buffer, count, format);
+    }
+
+    static void serialize_map_header(std::vector<uint8_t>& buffer, size_t pairs, ResponseFormat format = ResponseFormat::V1) {
+        buffer.push_back(static_cast<uint8_t>(SerializationType::Map));
+        append_length(buffer, pairs, format);
+    }
+
+    // String or Bulk, the V1 4 byte length or the V2 varint
+    static std::string deserialize_string(const std::vector<uint8_t>& buffer, ResponseFormat format = ResponseFormat::V1) {
+        if (buffer.empty() || (buffer[0] != static_cast<uint8_t>(SerializationType::String) &&
+                               buffer[0] != static_cast<uint8_t>(SerializationType::Bulk))) {
             return "";
         }
-        uint32_t size;
-        std::memcpy(&size, buffer.data() + 1, sizeof(uint32_t));
-        return std::string(buffer.begin() + 5, buffer.begin() + 5 + size);
+        size_t pos = 1;
+        auto size = read_length(buffer, pos, format);
+        if (!size || pos + *size > buffer.size()) {
+            return "";
+        }
+        return std::string(buffer.begin() + pos, buffer.begin() + pos + *size);
     }
 
     static bool deserialize_nil(const std::vector<uint8_t>& buffer) {
         return !buffer.empty() && buffer[0] == static_cast<uint8_t>(SerializationType::Nil);
     }
 
-    static int64_t deserialize_integer(const std::vector<uint8_t>& buffer) {
+    static int64_t deserialize_integer(const std::vector<uint8_t>& buffer, ResponseFormat format = ResponseFormat::V1) {
         if (buffer.empty() || buffer[0] != static_cast<uint8_t>(SerializationType::Integer)) {
             return -1; // Default error value
         }
     
-        int64_t value;
-        std::memcpy(&value, buffer.data() + 1, sizeof(int64_t));
-    
-        // Debugging Output
-        std::cout << "🔍 Debug: Deserialized integer " << value << " from buffer [";
-        for (auto byte : buffer) {
-            std::cout << static_cast<int>(byte) << " ";
+        int64_t value = -1;
+        if (format == ResponseFormat::V2) {
+            size_t pos = 1;
+            if (auto raw = read_varint(buffer, pos)) {
+                value = unzigzag(*raw);
+            }
+        } else {
+            std::from_chars(reinterpret_cast<const char*>(buffer.data()) + 1,
+                            reinterpret_cast<const char*>(buffer.data()) + buffer.size(), value);
         }
-        std::cout << "]" << std::endl;
+    
+        LOG_TRACE("Deserialized integer {} from a {} byte buffer", value, buffer.size());
     
         return value;
     }
     
 
-    static std::string deserialize_error(const std::vector<uint8_t>& buffer) {
+    static std::string deserialize_error(const std::vector<uint8_t>& buffer, ResponseFormat format = ResponseFormat::V1) {
         if (buffer.empty() || buffer[0] != static_cast<uint8_t>(SerializationType::Error)) {
             return "No error";
         }
-        uint32_t size;
-        std::memcpy(&size, buffer.data() + 5, sizeof(uint32_t));
-        return std::string(buffer.begin() + 9, buffer.begin() + 9 + size);
+        size_t pos = 1;
+        if (format == ResponseFormat::V2) {
+            if (!read_varint(buffer, pos)) return "No error";
+        } else {
+            pos += sizeof(int32_t);
+        }
+        auto size = read_length(buffer, pos, format);
+        if (!size || pos + *size > buffer.size()) {
+            return "No error";
+        }
+        return std::string(buffer.begin() + pos, buffer.begin() + pos + *size);
     }
+
     template<typename T>
     static void append_data(std::vector<uint8_t>& buffer, const T& data) {
         const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&data);
         buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
     }
+
+    // LEB128: 7 bits per byte, low bits first, high bit set on every byte but the last
+    static void append_varint(std::vector<uint8_t>& buffer, uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    static std::optional<uint64_t> read_varint(std::span<const uint8_t> buffer, size_t& pos) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64 && pos < buffer.size(); shift += 7) {
+            uint8_t byte = buffer[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        return std::nullopt;  // truncated or longer than 10 bytes
+    }
+
+    // small negative numbers stay small: 0, -1, 1, -2 ... encode as 0, 1, 2, 3 ...
+    static constexpr uint64_t zigzag(int64_t value) noexcept {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    static constexpr int64_t unzigzag(uint64_t value) noexcept {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+private:
+    static constexpr SerializationType bulk_type(ResponseFormat format) noexcept {
+        return format == ResponseFormat::V2 ? SerializationType::Bulk : SerializationType::String;
+    }
+
+    static void append_length(std::vector<uint8_t>& buffer, size_t len, ResponseFormat format) {
+        if (format == ResponseFormat::V2) {
+            append_varint(buffer, len);
+        } else {
+            append_data(buffer, static_cast<uint32_t>(len));
+        }
+    }
+
+    static std::optional<size_t> read_length(std::span<const uint8_t> buffer, size_t& pos, ResponseFormat format) {
+        if (format == ResponseFormat::V2) {
+            return read_varint(buffer, pos);
+        }
+        if (pos + sizeof(uint32_t) > buffer.size()) {
+            return std::nullopt;
+        }
+        uint32_t len;
+        std::memcpy(&len, buffer.data() + pos, sizeof(len));
+        pos += sizeof(len);
+        return len;
+    }
 };
 
 #endif // RESPONSE_SERIALIZER_HPP
@@ -43,6 +43,10 @@ public:
     AVLNode(AVLNode&&) noexcept = default;
     AVLNode& operator=(AVLNode&&) noexcept = default;
 
+    [[nodiscard]] const K& get_key() const noexcept { return key; }
+    [[nodiscard]] const V& get_value() const noexcept { return value; }
+    void set_value(const V& v) { value = v; }
+
     K key;
     V value;
     uint32_t depth {1};
@@ -93,7 +97,9 @@ public:
     }
     
     // `GET` 
-    std::optional<V> get(const K& key) const {
+    // get/exists/search take anything that orders against K (std::string_view for std::string keys)
+    template<typename Q = K>
+    std::optional<V> get(const Q& key) const {
         AVLNode<K, V>* node = search(key);
         if (!node) return std::nullopt;
         std::lock_guard<std::recursive_mutex> node_lock(node->node_mutex);
@@ -108,7 +114,8 @@ public:
     }
     
     // `EXISTS key` 
-    bool exists(const K& key) const {
+    template<typename Q = K>
+    bool exists(const Q& key) const {
         // std::cout << "[EXISTS] Checking if key exists: " << key << std::endl;
         std::shared_lock lock(tree_mutex);
         bool found = search(key) != nullptr;
@@ -139,7 +146,7 @@ std::unique_ptr<AVLNode<K, V>> insert(std::unique_ptr<AVLNode<K, V>> node, const
         node->right->parent = node.get();
     } else {
         // std::cout << "[INSERT] Duplicate key " << key << "\n";
-        return std::move(node);
+        return node;
     }
 
     return fix(std::move(node));
@@ -175,7 +182,8 @@ std::unique_ptr<AVLNode<K, V>> insert(std::unique_ptr<AVLNode<K, V>> node, const
         return fix(std::move(node));
     }
 
-    AVLNode<K, V>* search(const K& key) const {
+    template<typename Q = K>
+    AVLNode<K, V>* search(const Q& key) const {
         // std::cout << "[SEARCH] Searching for key: " << key << std::endl;
         AVLNode<K, V>* node = root_.get();
         
@@ -206,7 +214,7 @@ std::unique_ptr<AVLNode<K, V>> insert(std::unique_ptr<AVLNode<K, V>> node, const
             return fixRight(std::move(node));
         }
     
-        return std::move(node);
+        return node;
     }
     
 
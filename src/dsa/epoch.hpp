@@ -0,0 +1,194 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation for lock-free readers (HMap's find). A reader pins the current epoch for the length
+// of its walk (EpochGuard); a writer that unlinks a node hands it to retire() instead of deleting it, and it's
+// freed once the global epoch has moved on twice - by then every reader that could have seen it has unpinned.
+// The epoch only advances when every pinned thread has caught up with it, so a stalled reader holds memory back
+// but never blocks a writer.
+//
+// One process-wide domain. Each thread gets a record (reused after the thread exits) and its own retire list,
+// so pinning is one seq_cst store and retiring takes no lock.
+
+class EpochReclaimer {
+public:
+    static EpochReclaimer& instance() {
+        static EpochReclaimer reclaimer;
+        return reclaimer;
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // nests: only the outermost pin announces an epoch
+    void pin() {
+        ThreadState& state = local();
+        if (state.depth++ > 0) return;
+        if (!state.record) state.record = acquire_record();
+
+        // announce, then check the epoch didn't move before the announcement was visible - a reader must never
+        // sit on an epoch older than the one it started reading in. seq_cst store (xchg on x86, the same as a
+        // store and a fence) so a collector that reads it also sees everything before it, the last unpin included.
+        uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        while (true) {
+            state.record->epoch.store(epoch, std::memory_order_seq_cst);
+            uint64_t now = epoch_.load(std::memory_order_seq_cst);
+            if (now == epoch) break;
+            epoch = now;
+        }
+    }
+
+    void unpin() {
+        ThreadState& state = local();
+        if (--state.depth > 0) return;
+        state.record->epoch.store(QUIESCENT, std::memory_order_release);
+    }
+
+    // ptr is freed by deleter(ptr) once no pinned reader can still reach it. The caller has already unlinked it.
+    void retire(void* ptr, void (*deleter)(void*)) {
+        ThreadState& state = local();
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // the unlink is visible before we read the epoch
+        uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        state.limbo.push_back({ptr, deleter, epoch});
+        if (state.limbo.size() >= COLLECT_THRESHOLD) {
+            collect(state);
+        }
+    }
+
+    template<typename T>
+    void retire(T* ptr) {
+        retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // try to advance the epoch and free what this thread (and any exited thread) retired that's now safe.
+    // Called by retire every COLLECT_THRESHOLD items; call it directly after retiring something big.
+    void collect() { collect(local()); }
+
+    [[nodiscard]] uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_relaxed); }
+
+    // retired by this thread and not yet freed
+    [[nodiscard]] size_t pending() { return local().limbo.size(); }
+
+private:
+    static constexpr uint64_t QUIESCENT = 0;
+    static constexpr size_t COLLECT_THRESHOLD = 64;
+
+    struct alignas(64) Record {
+        std::atomic<uint64_t> epoch{QUIESCENT};
+        std::atomic<bool> in_use{true};
+        Record* next = nullptr;
+    };
+
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    struct ThreadState {
+        Record* record = nullptr;
+        unsigned depth = 0;
+        std::vector<Retired> limbo;
+
+        ThreadState() { limbo.reserve(2 * COLLECT_THRESHOLD); }  // retiring shouldn't allocate in the steady state
+        ~ThreadState() {
+            EpochReclaimer& reclaimer = instance();
+            if (record) {
+                record->epoch.store(QUIESCENT, std::memory_order_release);
+                record->in_use.store(false, std::memory_order_release);
+            }
+            if (!limbo.empty()) {  // left for whoever collects next
+                std::lock_guard lock(reclaimer.orphans_mutex_);
+                reclaimer.orphans_.insert(reclaimer.orphans_.end(), limbo.begin(), limbo.end());
+            }
+        }
+    };
+
+    std::atomic<uint64_t> epoch_{1};
+    std::atomic<Record*> records_{nullptr};  // push-only list, records are recycled rather than freed
+    std::mutex orphans_mutex_;
+    std::vector<Retired> orphans_;
+
+    EpochReclaimer() = default;
+
+    // at exit nobody is reading any more
+    ~EpochReclaimer() {
+        for (auto& item : orphans_) item.deleter(item.ptr);
+        for (Record* record = records_.load(std::memory_order_relaxed); record;) {
+            delete std::exchange(record, record->next);
+        }
+    }
+
+    static ThreadState& local() {
+        instance();  // constructed before any ThreadState, so it outlives them all
+        thread_local ThreadState state;
+        return state;
+    }
+
+    Record* acquire_record() {
+        for (Record* record = records_.load(std::memory_order_acquire); record; record = record->next) {
+            bool free = false;
+            if (!record->in_use.load(std::memory_order_relaxed) &&
+                record->in_use.compare_exchange_strong(free, true, std::memory_order_acquire)) {
+                return record;
+            }
+        }
+        auto* record = new Record();
+        record->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release)) {}
+        return record;
+    }
+
+    // the epoch moves from e to e + 1 once every pinned thread has announced e
+    void try_advance() {
+        uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        for (Record* record = records_.load(std::memory_order_acquire); record; record = record->next) {
+            uint64_t seen = record->epoch.load(std::memory_order_seq_cst);
+            if (seen != QUIESCENT && seen != epoch) return;
+        }
+        epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+    }
+
+    // anything retired in epoch e is unreachable once the epoch reaches e + 2
+    static void free_expired(std::vector<Retired>& items, uint64_t epoch) {
+        size_t kept = 0;
+        for (auto& item : items) {
+            if (item.epoch + 2 <= epoch) {
+                item.deleter(item.ptr);
+            } else {
+                items[kept++] = item;
+            }
+        }
+        items.resize(kept);
+    }
+
+    void collect(ThreadState& state) {
+        try_advance();
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        free_expired(state.limbo, epoch);
+
+        std::unique_lock lock(orphans_mutex_, std::try_to_lock);
+        if (lock.owns_lock() && !orphans_.empty()) {
+            free_expired(orphans_, epoch);
+        }
+    }
+};
+
+// RAII pin for the current thread, see EpochReclaimer
+class EpochGuard {
+public:
+    EpochGuard() { EpochReclaimer::instance().pin(); }
+    ~EpochGuard() { EpochReclaimer::instance().unpin(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#endif // EPOCH_HPP
@@ -0,0 +1,313 @@
+#ifndef FLAT_TABLE_HPP
+#define FLAT_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "hashtable.hpp"
+
+// Open-addressing alternative to HTable, Swiss-table style: one control byte per slot (EMPTY, DELETED, or the
+// low 7 bits of the key's hash), probed 16 at a time with a single SSE2 compare, and the key and value stored
+// inline in a flat slot array - a hit is one control group and one slot, no node to chase.
+//
+// Same interface as HTable so HMap can use either (HMap<K, V, FlatTable<K, V>>), with two differences:
+// - slots move when the table rehashes itself (only when tombstones pile up, growth is HMap's incremental
+//   migration), so a Node* or V& is only good until the next call that inserts into this table.
+// - insert doesn't look for an existing key, like HTable, but a duplicate is shadowed by the older one here.
+// No locks inside: HMap only writes to a table under its exclusive map lock, readers share it.
+
+template<typename K, typename V>
+struct FlatSlot {
+    FlatSlot(K key, V value) : key_(std::move(key)), value_(std::move(value)) {}
+
+    K key_;
+    V value_;
+};
+
+template<typename K, typename V>
+class FlatTable {
+public:
+    using Node = FlatSlot<K, V>;
+
+    static constexpr size_t GROUP_SIZE = 16;
+    static constexpr size_t min_capacity = GROUP_SIZE;
+    static constexpr double max_load_factor = 0.875;  // HMap starts a migration past this
+    static constexpr size_t node_bytes = sizeof(Node) + 1;  // slot plus control byte, for memory accounting
+    static constexpr bool concurrent_reads = false;  // slots move, readers share HMap's map lock
+
+    explicit FlatTable(size_t initial_size = 0) {
+        if (initial_size > 0) {
+            initialize(std::bit_ceil(std::max(initial_size, min_capacity)));
+        }
+    }
+    ~FlatTable() { release(); }
+
+    FlatTable(const FlatTable&) = delete;
+    FlatTable& operator=(const FlatTable&) = delete;
+
+    FlatTable(FlatTable&& other) noexcept { swap(other); }
+    FlatTable& operator=(FlatTable&& other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    V& insert(K key, V value) {
+        reserve_one();
+        uint64_t hash = hash_key(key);
+        size_t pos = find_free(hash);
+        place(pos, hash, std::move(key), std::move(value));
+        return slots_[pos].value_;
+    }
+
+    // Q is K or anything that hashes the same and compares equal to K (std::string_view for std::string keys)
+    template<typename Q = K>
+    Node* lookup(const Q& key) {
+        if (!ctrl_) return nullptr;
+        return find(key, hash_key(key));
+    }
+
+    template<typename Q = K>
+    std::optional<V> remove(const Q& key) {
+        if (!ctrl_) return std::nullopt;
+        Node* node = find(key, hash_key(key));
+        if (!node) return std::nullopt;
+        std::optional<V> value = std::move(node->value_);
+        erase(static_cast<size_t>(node - slots_));
+        return value;
+    }
+
+    // Batched versions: hash every key and prefetch its first control group before probing any, so the cache
+    // misses of a batch overlap instead of queueing. Items go in in order (see insert for duplicates).
+    void insert_many(std::vector<std::pair<K, V>>& items) {
+        if (items.empty()) return;
+        for (size_t i = 0; i < items.size(); ++i) {
+            reserve_one();
+            uint64_t hash = hash_key(items[i].first);
+            size_t pos = find_free(hash);
+            place(pos, hash, std::move(items[i].first), std::move(items[i].second));
+        }
+    }
+
+    // out[i] is only filled in when keys[i] is found and out[i] is still empty, so a second table can fill the gaps
+    template<typename Q = K>
+    void lookup_many(std::span<const Q> keys, std::span<Node*> out) {
+        if (!ctrl_) return;
+        std::vector<uint64_t> hashes = prefetch(keys);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!out[i]) out[i] = find(keys[i], hashes[i]);
+        }
+    }
+
+    template<typename Q = K>
+    void remove_many(std::span<const Q> keys, std::span<std::optional<V>> out) {
+        if (!ctrl_) return;
+        std::vector<uint64_t> hashes = prefetch(keys);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (out[i]) continue;
+            if (Node* node = find(keys[i], hashes[i])) {
+                out[i] = std::move(node->value_);
+                erase(static_cast<size_t>(node - slots_));
+            }
+        }
+    }
+
+    // Visits up to count entries, starting at slot start (masked) and walking on. For eviction sampling.
+    template<typename F>
+    size_t sample(size_t start, size_t count, F&& visit) {
+        size_t visited = 0;
+        for (size_t i = 0; i < capacity_ && visited < count && size_ > 0; ++i) {
+            size_t pos = (start + i) & (capacity_ - 1);
+            if (is_full(ctrl_[pos])) {
+                visit(slots_[pos].key_, slots_[pos].value_);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    // Moves up to max_work entries into dest, scanning at most max_scan slots on from pos (see HMap::migrate_step).
+    // The entries are moved, not re-linked, so pointers into this table don't survive it.
+    size_t migrate_to(FlatTable& dest, size_t& pos, size_t max_work, size_t max_scan) {
+        size_t moved = 0;
+        for (size_t scanned = 0; moved < max_work && scanned < max_scan && size_ > 0; ++pos, ++scanned) {
+            if (pos >= capacity_) pos = 0;
+            if (!is_full(ctrl_[pos])) continue;
+            dest.insert(std::move(slots_[pos].key_), std::move(slots_[pos].value_));
+            erase(pos);
+            moved++;
+        }
+        return moved;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    void clear() { release(); }
+
+private:
+    static constexpr int8_t EMPTY = -128;   // 0b10000000
+    static constexpr int8_t DELETED = -2;   // 0b11111110, full slots are 0b0xxxxxxx
+
+    // one 16 byte control group, each match is a bitmask of slots in it
+    struct Group {
+#if defined(__SSE2__)
+        __m128i ctrl;
+        explicit Group(const int8_t* p) noexcept : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+        [[nodiscard]] uint32_t match(int8_t h2) const noexcept {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))));
+        }
+        // EMPTY and DELETED are the only bytes with the top bit set
+        [[nodiscard]] uint32_t match_free() const noexcept { return static_cast<uint32_t>(_mm_movemask_epi8(ctrl)); }
+#else
+        int8_t ctrl[GROUP_SIZE];
+        explicit Group(const int8_t* p) noexcept { std::memcpy(ctrl, p, GROUP_SIZE); }
+        [[nodiscard]] uint32_t match(int8_t h2) const noexcept {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) mask |= uint32_t{ctrl[i] == h2} << i;
+            return mask;
+        }
+        [[nodiscard]] uint32_t match_free() const noexcept {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) mask |= uint32_t{ctrl[i] < 0} << i;
+            return mask;
+        }
+#endif
+        [[nodiscard]] uint32_t match_empty() const noexcept { return match(EMPTY); }
+    };
+
+    std::unique_ptr<int8_t[]> ctrl_;
+    Node* slots_ = nullptr;  // raw storage, a slot is constructed only while its control byte is full
+    size_t capacity_ = 0;    // slots, a power of two and a multiple of GROUP_SIZE
+    size_t group_mask_ = 0;
+    size_t size_ = 0;
+    size_t deleted_ = 0;
+
+    static bool is_full(int8_t ctrl) noexcept { return ctrl >= 0; }
+    static int8_t h2(uint64_t hash) noexcept { return static_cast<int8_t>(hash & 0x7F); }
+    size_t first_group(uint64_t hash) const noexcept { return (hash >> 7) & group_mask_; }
+
+    // Triangular probing over whole groups visits every group once for a power-of-two group count. A miss stops
+    // at the first group with an EMPTY slot, which reserve_one guarantees exists.
+    template<typename Q>
+    Node* find(const Q& key, uint64_t hash) {
+        int8_t tag = h2(hash);
+        size_t group = first_group(hash);
+        for (size_t step = 1;; ++step) {
+            Group ctrl(ctrl_.get() + group * GROUP_SIZE);
+            for (uint32_t match = ctrl.match(tag); match; match &= match - 1) {
+                size_t pos = group * GROUP_SIZE + std::countr_zero(match);
+                if (slots_[pos].key_ == key) return &slots_[pos];
+            }
+            if (ctrl.match_empty()) return nullptr;
+            group = (group + step) & group_mask_;
+        }
+    }
+
+    size_t find_free(uint64_t hash) const noexcept {
+        size_t group = first_group(hash);
+        for (size_t step = 1;; ++step) {
+            if (uint32_t free = Group(ctrl_.get() + group * GROUP_SIZE).match_free()) {
+                return group * GROUP_SIZE + std::countr_zero(free);
+            }
+            group = (group + step) & group_mask_;
+        }
+    }
+
+    void place(size_t pos, uint64_t hash, K key, V value) {
+        deleted_ -= ctrl_[pos] == DELETED;
+        std::construct_at(slots_ + pos, std::move(key), std::move(value));
+        ctrl_[pos] = h2(hash);
+        size_++;
+    }
+
+    // A group that still has an EMPTY slot never made a probe move past it, so the slot can go back to EMPTY;
+    // otherwise it becomes a tombstone that keeps later probes going.
+    void erase(size_t pos) {
+        std::destroy_at(slots_ + pos);
+        size_t group = pos / GROUP_SIZE;
+        bool keep_probing = !Group(ctrl_.get() + group * GROUP_SIZE).match_empty();
+        ctrl_[pos] = keep_probing ? DELETED : EMPTY;
+        deleted_ += keep_probing;
+        size_--;
+    }
+
+    // Keeps at least 1/16 of the slots EMPTY so every probe terminates. HMap grows the table long before that,
+    // so this only fires when deletes leave tombstones behind: rehash at the same size to sweep them (or double,
+    // if a batch insert during a migration got this far).
+    void reserve_one() {
+        if (!ctrl_) {
+            initialize(min_capacity);
+            return;
+        }
+        if ((size_ + deleted_ + 1) * GROUP_SIZE <= capacity_ * (GROUP_SIZE - 1)) return;
+        rehash(static_cast<double>(size_ + 1) >= capacity_ * max_load_factor ? capacity_ * 2 : capacity_);
+    }
+
+    void rehash(size_t capacity) {
+        FlatTable bigger(capacity);
+        for (size_t pos = 0; pos < capacity_; ++pos) {
+            if (!is_full(ctrl_[pos])) continue;
+            uint64_t hash = hash_key(slots_[pos].key_);
+            bigger.place(bigger.find_free(hash), hash, std::move(slots_[pos].key_), std::move(slots_[pos].value_));
+        }
+        *this = std::move(bigger);
+    }
+
+    template<typename Q>
+    std::vector<uint64_t> prefetch(std::span<const Q> keys) const {
+        std::vector<uint64_t> hashes(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            hashes[i] = hash_key(keys[i]);
+            __builtin_prefetch(ctrl_.get() + first_group(hashes[i]) * GROUP_SIZE);
+        }
+        return hashes;
+    }
+
+    void initialize(size_t capacity) {
+        assert(std::has_single_bit(capacity) && capacity >= GROUP_SIZE);
+        ctrl_ = std::make_unique<int8_t[]>(capacity);
+        std::memset(ctrl_.get(), EMPTY, capacity);
+        slots_ = std::allocator<Node>().allocate(capacity);
+        capacity_ = capacity;
+        group_mask_ = capacity / GROUP_SIZE - 1;
+        size_ = 0;
+        deleted_ = 0;
+    }
+
+    void release() noexcept {
+        if (slots_) {
+            for (size_t pos = 0; pos < capacity_; ++pos) {
+                if (is_full(ctrl_[pos])) std::destroy_at(slots_ + pos);
+            }
+            std::allocator<Node>().deallocate(slots_, capacity_);
+        }
+        ctrl_.reset();
+        slots_ = nullptr;
+        capacity_ = group_mask_ = size_ = deleted_ = 0;
+    }
+
+    void swap(FlatTable& other) noexcept {
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(group_mask_, other.group_mask_);
+        std::swap(size_, other.size_);
+        std::swap(deleted_, other.deleted_);
+    }
+};
+
+#endif // FLAT_TABLE_HPP
@@ -1,55 +1,128 @@
 #ifndef HASH_TABLE_HPP
 #define HASH_TABLE_HPP
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <functional>
 #include <type_traits>
+#include <string>
 #include <vector>
 #include <optional>
 #include <bit>
 #include <cassert>
 #include <bitset>
+#include <span>
+#include <algorithm>
+#include <utility>
 #include <mutex>
 #include <shared_mutex>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include "epoch.hpp"
+#include "../../logging.hpp"
 // To-Do: 
 /*
 1. Testing each Method - likely some inconsistencies in passing by ref/ptr (particularly in insert) 
 2. Multithreading/Concurrency applications & guardrails - MAJOR undertaking probably. Let's see if this shit runs first
 */
 
-// FNV-1a Hashing Algorithm with SIMD.
-// *** Some SIMD - Integrate with NEON later if you want. ***
+// wyhash (final 4): 64-bit multiply-mix hash. Keys up to 16 bytes are read as two overlapping words, longer
+// ones 16 bytes per step and past 48 bytes in three independent 16 byte lanes, so a long key hashes at several
+// bytes per cycle instead of FNV-1a's one. Always seeded: see hash_seed.
 
+namespace wyhash_detail {
+    constexpr uint64_t SECRET[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+                                    0x589965cc75374cc3ull};
 
-[[nodiscard]] inline std::uint64_t hash_key(const void* data, size_t len) noexcept {
-    constexpr uint64_t INITIAL = 0xCBF29CE484222325;
-    constexpr uint64_t MULTIPLIER = 0x100000001B3;
-
-    uint64_t hash = INITIAL;
-    const uint8_t* bytes = static_cast<const uint8_t*>(data);
-    size_t i = 0;
-
-    for (; i + 4 <= len; i += 4) { 
-        hash = (hash ^ bytes[i]) * MULTIPLIER;
-        hash = (hash ^ bytes[i + 1]) * MULTIPLIER;
-        hash = (hash ^ bytes[i + 2]) * MULTIPLIER;
-        hash = (hash ^ bytes[i + 3]) * MULTIPLIER;
+    // 64x64 -> 128 multiply, the two halves folded together
+    [[nodiscard]] inline uint64_t mix(uint64_t a, uint64_t b) noexcept {
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+    }
+    [[nodiscard]] inline uint64_t read8(const uint8_t* p) noexcept {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+    [[nodiscard]] inline uint64_t read4(const uint8_t* p) noexcept {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+    // 1 to 3 bytes: first, middle and last
+    [[nodiscard]] inline uint64_t read3(const uint8_t* p, size_t k) noexcept {
+        return (uint64_t{p[0]} << 16) | (uint64_t{p[k >> 1]} << 8) | p[k - 1];
     }
+}
 
-    for (; i < len; i++) {
-        hash = (hash ^ bytes[i]) * MULTIPLIER;
+[[nodiscard]] inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed) noexcept {
+    using namespace wyhash_detail;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
     }
+    a ^= SECRET[1];
+    b ^= seed;
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+    return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
 
-    return hash;
+// Random per process, so which keys collide can't be worked out offline and sent to fill one bucket. Every table,
+// ZSet and the keyspace shards hash with it; nothing hashed is persisted, so it never has to be stable.
+[[nodiscard]] inline uint64_t hash_seed() noexcept {
+    static const uint64_t seed = [] {
+        std::random_device device;
+        return (uint64_t{device()} << 32) ^ device() ^
+               static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }();
+    return seed;
+}
+
+[[nodiscard]] inline std::uint64_t hash_key(const void* data, size_t len) noexcept {
+    return hash_bytes(data, len, hash_seed());
 }
 template <typename K>
 [[nodiscard]] inline std::uint64_t hash_key(const K& key) noexcept {
     if constexpr (std::is_integral_v<K>) { 
         return hash_key(reinterpret_cast<const uint8_t*>(&key), sizeof(K));  
-    } else if constexpr (std::is_same_v<K, std::string> || std::is_same_v<K, std::string_view>) {
-        return hash_key(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+    } else if constexpr (std::is_convertible_v<const K&, std::string_view>) {  // std::string, string_view, literals
+        std::string_view view = key;
+        return hash_key(reinterpret_cast<const uint8_t*>(view.data()), view.size());
     } else if constexpr (std::is_same_v<K, std::vector<uint8_t>>) {
         return hash_key(reinterpret_cast<const uint8_t*>(key.data()), key.size());
     } else {
@@ -57,346 +130,700 @@ template <typename K>
     }
 }
 
+// bytes a std::string of this length allocates, 0 while it fits in the small string buffer (memory accounting -
+// by length rather than capacity so adding and later subtracting an entry always agree)
+[[nodiscard]] inline size_t string_heap_bytes(size_t length) noexcept {
+    static const size_t small_capacity = std::string().capacity();
+    return length > small_capacity ? length + 1 : 0;
+}
+
 // Basic RAII - Delete copy-consructors, allow transfer of ownership only.
-// Our Node contains its HashCode (generated by FNV-1a) and next_ (pointing to a unique_ptr).
+// Our Node contains its HashCode (from hash_key) and next_ (the next node in its bucket, owned by the table).
+// next_ is atomic so a reader can walk a chain while a writer relinks it: a node is filled in before a release
+// store publishes it, and one that's unlinked goes to the EpochReclaimer rather than straight to delete.
 
 template<typename K, typename V>
 class HNode {
 public:
     HNode(K key, V value, uint64_t hash) : key_(std::move(key)), value_(std::move(value)), hcode_(hash) {}
 
-    HNode() = delete; 
-    ~HNode() = default; 
-    
-    HNode(const HNode&) = delete; 
-    HNode& operator=(const HNode&) = delete; 
-    
-    HNode(HNode&&) noexcept = default; 
-    HNode& operator=(HNode&&) noexcept = default; 
+    HNode() = delete;
+    ~HNode() = default;
+
+    HNode(const HNode&) = delete;
+    HNode& operator=(const HNode&) = delete;
 
     K key_;
     V value_;
     std::uint64_t hcode_;
-    std::unique_ptr<HNode<K, V>> next_;
+    std::atomic<HNode<K, V>*> next_{nullptr};
 };
 
+// Writers are serialised by the owner (HMap's map lock). Lookups take no lock and may run alongside a writer,
+// as long as the reader is pinned (EpochGuard) so the nodes it walks aren't freed under it.
 template<typename K, typename V>
 class HTable {
 public:
+    using Node = HNode<K, V>;
+
+    static constexpr size_t min_capacity = 4;
+    static constexpr double max_load_factor = 8;  // average nodes per bucket before HMap grows the table
+    static constexpr size_t node_bytes = sizeof(Node);  // per entry, for memory accounting
+    static constexpr bool concurrent_reads = true;  // lookup(_many) is safe alongside a writer, see HMap::find
+
     // Constructor to roof initial_size to the nearest exponent of 2 and call initialize. (in private)
     explicit HTable(size_t initial_size = 0) {
         if (initial_size > 0) {
             initialize(std::bit_ceil(initial_size));
         }
     }
-    // RAII - Delete Copy Construction & Allow ownership transfer of unique_pointer nodes
-    HTable(const HTable&) = delete; 
-    HTable& operator=(const HTable&) = delete; 
+    ~HTable() { release(); }
 
-    HTable(HTable&&) noexcept = default; 
-    HTable& operator=(HTable&&) noexcept = default; 
+    // RAII - Delete Copy Construction & Allow ownership transfer of the buckets and their nodes
+    HTable(const HTable&) = delete;
+    HTable& operator=(const HTable&) = delete;
 
-    // Insert function with safety check (initialize on k_min_cap of 4 if empty) and move semantics.
-    void insert(K key, V value) {
-        if (buckets_.empty()) {
-            initialize(k_min_cap);
+    HTable(HTable&& other) noexcept { swap(other); }
+    HTable& operator=(HTable&& other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
         }
-    
+        return *this;
+    }
+
+    // Insert function with safety check (initialize on min_capacity of 4 if empty) and move semantics.
+    V& insert(K key, V value) {
+        if (!buckets_) {
+            initialize(min_capacity);
+        }
+
         uint64_t hash = hash_key(key);  // FIXED: Use correct `hash_key` function
         size_t pos = hash & mask_;
-        std::cout << "[Insert] Key: " << key << ", Hash: " << hash << ", pos: " << pos << std::endl;
-        std::unique_lock lock(*bucket_locks_[pos]);          
-        auto node = std::make_unique<HNode<K, V>>(std::move(key), std::move(value), hash);
-        node->next_ = std::move(buckets_[pos]);          
-        buckets_[pos] = std::move(node);
-        size_++;
+        LOG_TRACE("[Insert] Key: {}, Hash: {}, pos: {}", key, hash, pos);
+        auto* node = new Node(std::move(key), std::move(value), hash);
+        link(pos, node);
+        return node->value_;
     }
-    
 
-    HNode<K, V>* lookup(const K& key) {
-        if (buckets_.empty()) return nullptr;
-    
+
+    // Q is K or anything that hashes the same and compares equal to K (std::string_view for std::string keys).
+    // The stored hash is compared first, so a long chain costs a key compare only on a likely match.
+    template<typename Q = K>
+    Node* lookup(const Q& key) {
+        if (!buckets_) return nullptr;
+
         uint64_t hash = hash_key(key);
-        size_t pos = hash & mask_;
-    
-        std::shared_lock lock(*bucket_locks_[pos]);  // shared access for readers
-        HNode<K, V>* current = buckets_[pos].get();
-    
-        while (current) {
-            if (current->key_ == key) return current;
-            current = current->next_.get();
+        for (Node* current = buckets_[hash & mask_].load(std::memory_order_acquire); current;
+             current = current->next_.load(std::memory_order_acquire)) {
+            if (current->hcode_ == hash && current->key_ == key) return current;
         }
         return nullptr;
     }
-    
-    
 
-    // Accept anonymous comparator function and key, given the mask_ and position, get index current with raw ptr
-    // and iterate until comparator is true, we return the unique_pointer after rechaining (avoid dangling ptrs).
-    std::optional<V> remove(const K& key) {
-        if (buckets_.empty()) {
+
+
+    // Walk the chain keeping the link that points at current, so unlinking is one store into it; the node itself
+    // is retired (a reader may still be on it) after its value is moved out.
+    // Q as in lookup, so removing by a std::string_view doesn't build a std::string first.
+    template<typename Q = K>
+    std::optional<V> remove(const Q& key) {
+        if (!buckets_) {
             return std::nullopt;
         }
-    
+
         uint64_t hash = hash_key(key);
-        size_t pos = hash & mask_;
-        std::unique_lock lock(*bucket_locks_[pos]);  
-        HNode<K, V>* current = buckets_[pos].get();
-        HNode<K, V>* prev = nullptr;
-    
-        while (current) {
-            if (current->key_ == key) {
+        std::atomic<Node*>* link = &buckets_[hash & mask_];
+        for (Node* current = link->load(std::memory_order_relaxed); current;
+             link = &current->next_, current = link->load(std::memory_order_relaxed)) {
+            if (current->hcode_ == hash && current->key_ == key) {
                 std::optional<V> value = std::move(current->value_);
-    
-                if (prev) {
-                    prev->next_ = std::move(current->next_);
-                } else {
-                    buckets_[pos] = std::move(current->next_);
-                }
-    
-                size_--;
+                unlink(*link, current);
                 return value;
             }
-            prev = current;
-            current = current->next_.get();
         }
         return std::nullopt;
     }
 
-    std::unique_ptr<HNode<K, V>> steal_first_node(size_t& pos) {
-        while (pos < buckets_.size() && !buckets_[pos]) {
-            pos++; 
+    // Batched versions of insert/lookup/remove: hash every key and prefetch its bucket first, then walk the keys
+    // in order, so the cache misses of a batch overlap instead of queueing. A key given twice behaves as if done
+    // one after the other.
+    void insert_many(std::vector<std::pair<K, V>>& items) {
+        if (items.empty()) return;
+        if (!buckets_) {
+            initialize(min_capacity);
+        }
+
+        std::vector<uint64_t> hashes(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            hashes[i] = hash_key(items[i].first);
+            __builtin_prefetch(&buckets_[hashes[i] & mask_]);
         }
-    
-        if (pos >= buckets_.size()) {
-            return nullptr;
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto& [key, value] = items[i];
+            link(hashes[i] & mask_, new Node(std::move(key), std::move(value), hashes[i]));
         }
+    }
 
-        std::unique_lock lock(*bucket_locks_[pos]);  
-        auto node = std::move(buckets_[pos]);
-        buckets_[pos] = std::move(node->next_);
-        size_--;
-        return node;
+    // out[i] is only filled in when keys[i] is found and out[i] is still empty, so a second table can fill the gaps
+    template<typename Q = K>
+    void lookup_many(std::span<const Q> keys, std::span<Node*> out) {
+        if (!buckets_) return;
+
+        for_each_key(keys, [&](size_t k, uint64_t hash) {
+            if (out[k]) return;
+            for (Node* current = buckets_[hash & mask_].load(std::memory_order_acquire); current;
+                 current = current->next_.load(std::memory_order_acquire)) {
+                if (current->hcode_ == hash && current->key_ == keys[k]) {
+                    out[k] = current;
+                    return;
+                }
+            }
+        });
+    }
+
+    template<typename Q = K>
+    void remove_many(std::span<const Q> keys, std::span<std::optional<V>> out) {
+        if (!buckets_) return;
+
+        for_each_key(keys, [&](size_t k, uint64_t hash) {
+            if (out[k]) return;
+            std::atomic<Node*>* link = &buckets_[hash & mask_];
+            for (Node* current = link->load(std::memory_order_relaxed); current;
+                 link = &current->next_, current = link->load(std::memory_order_relaxed)) {
+                if (current->hcode_ == hash && current->key_ == keys[k]) {
+                    out[k] = std::move(current->value_);
+                    unlink(*link, current);
+                    return;
+                }
+            }
+        });
+    }
+
+    // Visits up to count nodes, whole buckets at a time, starting at bucket start (masked) and walking on.
+    // For eviction sampling: callers pick a random start. Returns how many were visited.
+    template<typename F>
+    size_t sample(size_t start, size_t count, F&& visit) {
+        size_t visited = 0;
+        for (size_t i = 0; i < capacity() && buckets_ && visited < count && size_ > 0; ++i) {
+            size_t pos = (start + i) & mask_;
+            for (Node* node = buckets_[pos].load(std::memory_order_relaxed); node && visited < count;
+                 node = node->next_.load(std::memory_order_relaxed)) {
+                visit(node->key_, node->value_);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    // re-links a node taken from another table (see HMap::migrate_step), its key and value never move
+    void insert_node(Node* node) {
+        if (!buckets_) {
+            initialize(min_capacity);
+        }
+        link(node->hcode_ & mask_, node);
     }
-    
-    [[nodiscard]] size_t size() const noexcept { return size_; } 
-    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; } 
-    bool empty() const noexcept { return size_ == 0; } 
 
+    // Moves up to max_work nodes into dest, from bucket pos on (see HMap::migrate_step), looking at no more than
+    // max_scan buckets on the way so a step over a sparse table (a shrink) is bounded too. Nodes are re-linked,
+    // their keys and values never move. A reader on a moved node follows its next_ into dest's chain, so it can
+    // pass over the rest of the old one: HMap retries a miss that overlapped a migration step.
+    size_t migrate_to(HTable& dest, size_t& pos, size_t max_work, size_t max_scan) {
+        size_t moved = 0;
+        for (size_t scanned = 0; moved < max_work && scanned < max_scan && !empty(); ++scanned) {
+            if (pos >= capacity()) {
+                pos = 0;
+            }
+            Node* node = buckets_[pos].load(std::memory_order_relaxed);
+            if (!node) {
+                pos++;  // Only advance when the bucket is empty
+                continue;
+            }
+            buckets_[pos].store(node->next_.load(std::memory_order_relaxed), std::memory_order_release);
+            size_--;
+            dest.insert_node(node);
+            moved++;
+        }
+        return moved;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // frees every node now: only with no reader on the table (HMap::clear retires the whole table instead)
     void clear() {
-        buckets_.clear();  
-        size_ = 0;
-        mask_ = 0;
+        release();
     }
-    
+
 private:
-    std::vector<std::unique_ptr<HNode<K,V>>> buckets_; 
-    std::vector<std::unique_ptr<std::shared_mutex>> bucket_locks_;
-    size_t mask_{0}; 
-    size_t size_{0}; 
+    std::unique_ptr<std::atomic<Node*>[]> buckets_;
+    size_t mask_{0};
+    size_t size_{0};
+
+    // the node is complete before the release store makes it reachable. next_ is a release store too: a node
+    // migrated onto this chain is reached from the old table through it, not through the bucket.
+    void link(size_t pos, Node* node) {
+        node->next_.store(buckets_[pos].load(std::memory_order_relaxed), std::memory_order_release);
+        buckets_[pos].store(node, std::memory_order_release);
+        size_++;
+    }
 
-    static constexpr size_t k_min_cap = 4;
+    void unlink(std::atomic<Node*>& link, Node* node) {
+        link.store(node->next_.load(std::memory_order_relaxed), std::memory_order_release);
+        size_--;
+        EpochReclaimer::instance().retire(node);
+    }
 
-    // Helper function for our constructor, 
+    // on_key(key index, hash) for every key in order, after hashing them all and prefetching their buckets
+    template<typename Q, typename F>
+    void for_each_key(std::span<const Q> keys, F&& on_key) {
+        std::vector<uint64_t> hashes(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            hashes[i] = hash_key(keys[i]);
+            __builtin_prefetch(&buckets_[hashes[i] & mask_]);
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            on_key(i, hashes[i]);
+        }
+    }
+
+    // Helper function for our constructor,
     // A. Check if capacity is exponent of 2, if true, continue
     // B. Ensure capacity is at least 4, and resize it
-    // C. Initilize mask_ as capacity - 1 (bitmasking operation for XOR replacement) and init size_ to 0. 
-    void initialize(size_t capacity) { 
-        assert(std::has_single_bit(capacity));  
-        capacity = std::max(capacity, k_min_cap); 
-        
-        buckets_.resize(capacity);
-        bucket_locks_.resize(capacity);
-        for (size_t i = 0; i < capacity; ++i) {
-            bucket_locks_[i] = std::make_unique<std::shared_mutex>();
+    // C. Initilize mask_ as capacity - 1 (bitmasking operation for XOR replacement) and init size_ to 0.
+    void initialize(size_t capacity) {
+        assert(std::has_single_bit(capacity));
+        capacity = std::max(capacity, min_capacity);
+
+        buckets_ = std::make_unique<std::atomic<Node*>[]>(capacity);  // value-initialised, all nullptr
+
+        mask_ = capacity - 1;
+        size_ = 0;
+    }
+
+    void release() {
+        for (size_t pos = 0; buckets_ && pos < capacity(); ++pos) {
+            for (Node* node = buckets_[pos].load(std::memory_order_relaxed); node;) {
+                delete std::exchange(node, node->next_.load(std::memory_order_relaxed));
+            }
         }
+        buckets_.reset();
+        mask_ = 0;
+        size_ = 0;
+    }
 
-        mask_ = capacity - 1; 
-        size_ = 0; 
+    void swap(HTable& other) noexcept {
+        std::swap(buckets_, other.buckets_);
+        std::swap(mask_, other.mask_);
+        std::swap(size_, other.size_);
     }
 };
 
-template<typename K, typename V>
+// Incrementally resized map over a Table: HTable (chained, the default) or FlatTable (open addressing, see
+// flat_table.hpp). A Table provides Node (with key_ and value_), min_capacity, max_load_factor, node_bytes,
+// concurrent_reads and the insert/lookup/remove(_many), sample and migrate_to calls below.
+//
+// Writers hold map_mutex_. When the Table has concurrent_reads (HTable) readers take no lock at all: find and
+// find_many pin an epoch and walk the tables as published (atomic pointers, release stores), and the writer
+// retires what it unlinks - nodes, and the old table once a migration finishes. A node moving between tables
+// can be passed over, so a miss only counts if no migration step ran during the walk (migration_seq_, odd
+// while one is running). FlatTable moves slots around, its readers still share map_mutex_.
+//
+// Resizing means growing past max_load_factor and shrinking once mostly empty. How it's paid for depends on the
+// RehashMode. In Background mode the owner calls rehash with a deadline off the request path (EntryManager's
+// rehash cycle does for the keyspace maps). Inserts then only help the migration along under pressure - when the
+// new table is filling up before the old one has been emptied into it. In Foreground mode, the default for maps
+// nobody drives (a ZSet's members), every insert and remove moves a bounded step. A remove that leaves the map at
+// an eighth of its maximum load starts the shrink itself. Either way no single operation pays for a whole resize.
+enum class RehashMode : uint8_t {
+    Foreground,
+    Background
+};
+
+template<typename K, typename V, typename Table = HTable<K, V>>
 class HMap {
 public:
+    using Node = typename Table::Node;
+    static constexpr size_t node_bytes = Table::node_bytes;
+    static constexpr bool concurrent_reads = Table::concurrent_reads;
+
     HMap() = default;
-    ~HMap() = default;
+    explicit HMap(RehashMode mode) noexcept : mode_(mode) {}
+    ~HMap() {
+        delete primary_.load(std::memory_order_relaxed);
+        delete temporary_.load(std::memory_order_relaxed);
+    }
 
-    // RAII - Delete Copy Construction & Allow ownership transfer of unique_pointer nodes
-    HMap(const HMap&) = delete; 
-    HMap& operator=(const HMap&) = delete; 
+    // RAII - Delete Copy Construction & Allow ownership transfer of the tables
+    HMap(const HMap&) = delete;
+    HMap& operator=(const HMap&) = delete;
 
     HMap(HMap&& other) noexcept
-    : primary_table_(std::move(other.primary_table_)),
-      temporary_table_(std::move(other.temporary_table_)),
-      resizing_pos_(other.resizing_pos_) {}
+    : primary_(other.primary_.exchange(nullptr)),
+      temporary_(other.temporary_.exchange(nullptr)),
+      resizing_pos_(std::exchange(other.resizing_pos_, 0)),
+      mode_(other.mode_) {}
 
     HMap& operator=(HMap&& other) noexcept {
         if (this != &other) {
-            primary_table_ = std::move(other.primary_table_);
-            temporary_table_ = std::move(other.temporary_table_);
-            resizing_pos_ = other.resizing_pos_;
+            delete primary_.exchange(other.primary_.exchange(nullptr));
+            delete temporary_.exchange(other.temporary_.exchange(nullptr));
+            resizing_pos_ = std::exchange(other.resizing_pos_, 0);
+            mode_ = other.mode_;
         }
         return *this;
     }
 
-    // If our primary HTable is empty, we 
-    void insert(K key, V value) { 
+    // If our primary table is empty, we create it. Returns the stored value, which stays put like find()'s pointer.
+    // Migration is helped (under pressure) before inserting rather than after, so nothing moves the new entry before it's returned.
+    V& insert(K key, V value) {
         std::unique_lock lock(map_mutex_);
-        if (primary_table_.empty()) {
-            primary_table_ = HTable<K, V>(k_min_cap);
-        }
-        uint64_t hash = hash_key(key);
-    
+        help_resize(max_work);
+        Table& table = writable_primary();
         // Calculate the load factor using floating point division
-        double load_factor = static_cast<double>(primary_table_.size()) / primary_table_.capacity();
-        std::cout << "[Insert] Load factor: " << load_factor << " for key " << key << std::endl;
-        
-        // If the load factor exceeds the threshold, trigger resizing
-        if (load_factor >= k_max_load_factor) {
-            std::cout << "[Resize Triggered] Load factor exceeded threshold." << std::endl;
-            start_resize();
-        }
-    
-        primary_table_.insert(key, value);
-        lock.unlock();
-        help_resize();
-    }
-    
-    
-    
-    
-    
-    // Pass in a key and comparator function. We call help_resize before to ensure our node isn't lost after the 15 swaps!
-    V* find(const K& key) {
-        help_resize();
-    
-        {
-            std::shared_lock lock(map_mutex_);  
-            
-            if (auto* node = primary_table_.lookup(key)) {
-                return &(node->value_);
-            }
+        double load_factor = static_cast<double>(table.size()) / table.capacity();
+        LOG_TRACE("[Insert] Load factor: {} for key {}", load_factor, key);
+
+        // If the load factor exceeds the threshold, trigger resizing (unless a migration is still in flight)
+        if (load_factor >= Table::max_load_factor && !temporary()) {
+            LOG_TRACE("[Resize Triggered] Load factor exceeded threshold.");
+            start_resize(table.capacity() * 2);
         }
-    
-        if (temporary_table_) {  
-            if (auto* node = temporary_table_->lookup(key)) {
-                return &(node->value_);
+
+        return primary()->insert(std::move(key), std::move(value));
+    }
+
+
+
+
+
+    // Lock-free over HTable (see above); over FlatTable we probe under the shared lock.
+    // The returned V* outlives the EpochGuard, which only covers the walk: once find returns, nothing stops a
+    // concurrent remove from retiring the node and the epoch from freeing it. So the pointer is only safe while
+    // the caller keeps removers out - the keyspace shard lock (ShardLocks) that GET still takes does. Migration
+    // re-links nodes rather than moving them, so under that lock the pointer holds until the key is removed or
+    // the map cleared. Over FlatTable entries do move (migration, tombstone sweeps), the pointer is only good
+    // until the next call on the map. Either way the value itself is the caller's to synchronise with writers.
+    template<typename Q = K>
+    V* find(const Q& key) {
+        if constexpr (Table::concurrent_reads) {
+            EpochGuard guard;
+            while (true) {
+                uint64_t seq = migration_seq_.load(std::memory_order_acquire);
+                if (Node* node = lookup(key)) {
+                    return &(node->value_);
+                }
+                if (stable_since(seq)) {
+                    return nullptr;
+                }
             }
+        } else {
+            std::shared_lock lock(map_mutex_);
+            Node* node = lookup(key);
+            return node ? &(node->value_) : nullptr;
         }
-    
-        return nullptr;
     }
-    
-    // Once again, similar to find - We pass in a key and comparator function, and we call help_resize. We should call it earlier here as 
-    // this improves our performance as keys are migrated to primary_DB, this increases our chances of finding the key in the first check.
-    std::optional<V> remove(const K& key) {
-        help_resize();
 
+    // Once again, similar to find - primary first, as that's where a key ends up once it's been migrated.
+    template<typename Q = K>
+    std::optional<V> remove(const Q& key) {
         std::unique_lock lock(map_mutex_);  // Lock for modifying structure
-        if (auto node = primary_table_.remove(key)) {  // node is `std::optional<V>`
-            return node;  // FIXED: return `std::optional<V>` directly
+        std::optional<V> value;
+        if (Table* table = primary()) {
+            value = table->remove(key);
+        }
+        if (Table* old = temporary(); old && !value) {
+            value = old->remove(key);
         }
-    
-        if (temporary_table_) {
-            if (auto node = temporary_table_->remove(key)) {
-                return node;  // FIXED
+        if (value) {
+            after_remove(max_work);
+        }
+        return value;
+    }
+
+    // Batched insert/find/remove for multi-key commands: the map lock once for the whole batch instead of once per
+    // key (see HTable::lookup_many). Under pressure a batch helps the migration as much as its keys would one by one.
+    void insert_many(std::vector<std::pair<K, V>> items) {
+        std::unique_lock lock(map_mutex_);
+        help_resize(max_work * items.size());
+        Table& table = writable_primary();
+        double load_factor = static_cast<double>(table.size() + items.size()) / table.capacity();
+        if (load_factor >= Table::max_load_factor && !temporary()) {
+            LOG_TRACE("[Resize Triggered] Load factor exceeded threshold.");
+            start_resize(table.capacity() * 2);
+        }
+
+        primary()->insert_many(items);
+    }
+
+    // out[i] points at the value for keys[i], nullptr when it isn't there. The pointers rely on the caller's lock
+    // like find's.
+    template<typename Q = K>
+    void find_many(std::span<const Q> keys, std::span<V*> out) {
+        std::vector<Node*> nodes(keys.size(), nullptr);
+        if constexpr (Table::concurrent_reads) {
+            EpochGuard guard;
+            while (true) {
+                uint64_t seq = migration_seq_.load(std::memory_order_acquire);
+                lookup_many(keys, std::span<Node*>(nodes));  // only fills the gaps on a retry
+                if (std::find(nodes.begin(), nodes.end(), nullptr) == nodes.end() || stable_since(seq)) {
+                    break;
+                }
             }
+        } else {
+            std::shared_lock lock(map_mutex_);
+            lookup_many(keys, std::span<Node*>(nodes));
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            out[i] = nodes[i] ? &nodes[i]->value_ : nullptr;
         }
-    
-        return std::nullopt;
     }
-    
-    
-    
-    std::unique_ptr<HNode<K, V>> steal_first_node(size_t& pos) {
-        std::cout << "[Steal] pos=" << pos << std::endl;
+
+    // out[i] gets the removed value for keys[i]
+    template<typename Q = K>
+    void remove_many(std::span<const Q> keys, std::span<std::optional<V>> out) {
         std::unique_lock lock(map_mutex_);
-        if (!temporary_table_) return nullptr;
-        return temporary_table_->steal_first_node(pos);
+        if (Table* table = primary()) {
+            table->remove_many(keys, out);
+        }
+        if (Table* old = temporary()) {
+            old->remove_many(keys, out);
+        }
+        after_remove(max_work * keys.size());
     }
-    
 
-    
-    [[nodiscard]] size_t size() const noexcept {
-        return primary_table_.size() + 
-               (temporary_table_ ? temporary_table_->size() : 0); // Get the size of both primary and resizing table (if exists).
+    // up to count entries from around a random spot (start), visit(key, value) - see HTable::sample.
+    // Tops up from the table being migrated away from when the primary one runs short.
+    template<typename F>
+    size_t sample(size_t start, size_t count, F&& visit) {
+        std::shared_lock lock(map_mutex_);
+        size_t visited = 0;
+        if (Table* table = primary()) {
+            visited = table->sample(start, count, visit);
+        }
+        if (Table* old = temporary(); old && visited < count) {
+            visited += old->sample(start, count - visited, visit);
+        }
+        return visited;
+    }
+
+
+    // Resize work off the request path: starts a shrink if the map has emptied out to an eighth of its maximum
+    // load, then migrates background_work entries per step, taking the map lock for each step only (a writer waits
+    // for one step at most), until the migration is done or deadline has passed - at least one step either way.
+    // True while there's still a migration to finish.
+    bool rehash(std::chrono::steady_clock::time_point deadline) {
+        while (true) {
+            std::unique_lock lock(map_mutex_);
+            if (!temporary()) {
+                start_shrink();  // also right after a grow finishes, if the keys went meanwhile
+            }
+            if (!temporary()) {
+                return false;
+            }
+            migrate_step(background_work);
+            lock.unlock();
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return resizing();
+            }
+        }
+    }
+
+    [[nodiscard]] bool resizing() const noexcept { return temporary_.load(std::memory_order_acquire) != nullptr; }
+
+    // of the table new entries go to (the bigger one mid-grow, the smaller one mid-shrink)
+    [[nodiscard]] size_t capacity() const {
+        std::shared_lock lock(map_mutex_);
+        Table* table = primary();
+        return table ? table->capacity() : 0;
+    }
+
+    // under the shared map lock, rehash may be moving entries between the tables
+    [[nodiscard]] size_t size() const {
+        std::shared_lock lock(map_mutex_);
+        Table* table = primary();
+        Table* old = temporary();
+        return (table ? table->size() : 0) + (old ? old->size() : 0); // Get the size of both primary and resizing table (if exists).
     }
-    
-    bool empty() const noexcept { return size() == 0; } // method for checking if the above size()==0, for convenience.
-    
+
+    bool empty() const { return size() == 0; } // method for checking if the above size()==0, for convenience.
+
+    // both tables are swapped out and retired, a concurrent reader finishes its walk on the old ones
     void clear() {
-        primary_table_.clear();  // Clear primary hash table
-        temporary_table_.reset();  // Remove temporary table if resizing
+        std::unique_lock lock(map_mutex_);
+        begin_migration();
+        Table* table = primary_.exchange(nullptr, std::memory_order_acq_rel);
+        Table* old = temporary_.exchange(nullptr, std::memory_order_acq_rel);
         resizing_pos_ = 0;  // Reset migration position
+        end_migration();
+        retire_table(table);
+        retire_table(old);
     }
-    
+
 private:
-    static constexpr size_t max_work = 15; // 15 transfers per help_resize call 
-    static constexpr size_t k_max_load_factor = 8; // Max Average of 8 nodes per bucket before start_resize is called!
-    static constexpr size_t k_min_cap = 4; // If constructor is called we want the minimum capacity to be 4 buckets!
+    static constexpr size_t max_work = 15; // 15 transfers per insert/remove that helps
+    static constexpr size_t background_work = 64; // per rehash step, small enough that a writer barely waits
+    static constexpr size_t scan_ratio = 8; // buckets a step may look at per entry it may move
 
-    HTable<K,V> primary_table_;
-    std::optional<HTable<K,V>> temporary_table_;
+    std::atomic<Table*> primary_{nullptr};
+    std::atomic<Table*> temporary_{nullptr};  // the table being migrated away from, while a resize is running
     size_t resizing_pos_{0};
+    std::atomic<uint64_t> migration_seq_{0};
+    RehashMode mode_{RehashMode::Foreground};
     mutable std::shared_mutex map_mutex_;
-    void help_resize() {
-        // Sanity check! Do not proceed if resizing table does not exist
-        if (!temporary_table_) {
-            std::cout << "[HelpResize] No temporary table. Skipping." << std::endl;
+
+    Table* primary() const noexcept { return primary_.load(std::memory_order_acquire); }
+    Table* temporary() const noexcept { return temporary_.load(std::memory_order_acquire); }
+
+    // primary first: a key already migrated is found without touching the old table
+    template<typename Q>
+    Node* lookup(const Q& key) const {
+        if (Table* table = primary()) {
+            if (Node* node = table->lookup(key)) {
+                return node;
+            }
+        }
+        Table* old = temporary();
+        return old ? old->lookup(key) : nullptr;
+    }
+
+    template<typename Q>
+    void lookup_many(std::span<const Q> keys, std::span<Node*> nodes) const {
+        if (Table* table = primary()) {
+            table->lookup_many(keys, nodes);
+        }
+        if (Table* old = temporary()) {
+            old->lookup_many(keys, nodes);
+        }
+    }
+
+    // seqlock-style check for the lock-free readers: true if no migration step overlapped the walk since seq
+    bool stable_since(uint64_t seq) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return !(seq & 1) && migration_seq_.load(std::memory_order_relaxed) == seq;
+    }
+
+    // brackets anything that moves nodes between the published tables, caller holds map_mutex_ exclusively
+    void begin_migration() noexcept {
+        migration_seq_.store(migration_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void end_migration() noexcept {
+        migration_seq_.store(migration_seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // lock-free readers may still be on it, it goes once they've all moved on
+    void retire_table(Table* table) {
+        if (!table) return;
+        if constexpr (Table::concurrent_reads) {
+            EpochReclaimer::instance().retire(table);
+            EpochReclaimer::instance().collect();
+        } else {
+            delete table;  // readers hold map_mutex_ shared, we hold it exclusively
+        }
+    }
+
+    // the primary table, created on first use. Caller holds map_mutex_ exclusively.
+    Table& writable_primary() {
+        Table* table = primary();
+        if (!table) {
+            table = new Table(Table::min_capacity);
+            primary_.store(table, std::memory_order_release);
+        }
+        return *table;
+    }
+
+    // Foreground help, caller holds map_mutex_ exclusively. Always in Foreground mode. In Background mode only
+    // when the table new entries go to has reached 3/4 of its maximum load counting what's still to come over from
+    // the old one, so inserts can't outrun a slow rehash driver and push it past its limit before the migration is done.
+    void help_resize(size_t work) {
+        Table* old = temporary();
+        if (!old) {
             return;
         }
-    
-        std::cout << "[Resize] Starting. pos=" << resizing_pos_ << ", size=" 
-                  << temporary_table_->size() << std::endl; 
-    
-        std::unique_lock lock(map_mutex_); 
-        size_t work_done = 0;
-    
-        while (work_done < max_work && !temporary_table_->empty()) {
-            std::cout << "[HelpResize] Attempting steal @ pos " << resizing_pos_ << std::endl;
-    
-            auto node = temporary_table_->steal_first_node(resizing_pos_);
-            if (node) {
-                std::cout << "[HelpResize] Moving key: " << node->key_ << std::endl;
-                primary_table_.insert(std::move(node->key_), std::move(node->value_));
-                work_done++;
-            } else {
-                std::cout << "[HelpResize] No node to steal at pos " << resizing_pos_ << ", incrementing." << std::endl;
-                resizing_pos_++;  // Only advance when the bucket is empty
-            }
-    
-            // Debug if resizing_pos_ goes out of bounds
-            if (resizing_pos_ >= temporary_table_->capacity()) {
-                std::cout << "[HelpResize] Warning: resizing_pos_ exceeded capacity. Resetting." << std::endl;
-                resizing_pos_ = 0;  // Reset if out of bounds
+        if (mode_ == RehashMode::Background) {
+            Table* table = primary();
+            double pending_load = static_cast<double>(table->size() + old->size()) / table->capacity();
+            if (pending_load < Table::max_load_factor * 3 / 4) {
+                return;
             }
         }
-    
-        if (temporary_table_->empty()) { 
-            temporary_table_.reset();
+        migrate_step(work);
+    }
+
+    // In Foreground mode nobody else will shrink the map, so a remove moves the migration along and starts a shrink
+    // once the map is sparse enough. A remove never adds load, so in Background mode it leaves both to rehash.
+    void after_remove(size_t work) {
+        if (mode_ == RehashMode::Background) {
+            return;
+        }
+        help_resize(work);
+        if (!temporary()) {
+            start_shrink();
+        }
+    }
+
+    // Moves up to work entries from the old table, caller holds map_mutex_ exclusively. The last step drops the
+    // old table, which is retired rather than freed in case a reader is still walking it.
+    void migrate_step(size_t work) {
+        Table* old = temporary();
+        if (!old) {
+            LOG_TRACE("[HelpResize] No temporary table. Skipping.");
+            return;
+        }
+
+        LOG_TRACE("[Resize] Starting. pos={}, size={}", resizing_pos_, old->size());
+
+        begin_migration();
+        size_t work_done = old->migrate_to(*primary(), resizing_pos_, work, work * scan_ratio);
+        LOG_TRACE("[HelpResize] Moved {} entries, pos={}", work_done, resizing_pos_);
+
+        bool done = old->empty();
+        if (done) {
+            temporary_.store(nullptr, std::memory_order_release);
             resizing_pos_ = 0;
-            std::cout << "[HelpResize] Completed resizing, reset temporary_table." << std::endl;
+            LOG_TRACE("[HelpResize] Completed resizing, reset temporary_table.");
+        }
+        end_migration();
+        if (done) {
+            retire_table(old);
         }
     }
-    
-    void start_resize() {
-        std::unique_lock lock(map_mutex_);
-        assert(!temporary_table_); // First a sanity check that resizing table doesn't already exist!
-    
-        size_t new_capacity = primary_table_.capacity() * 2; // New capacity is 2x previous, this is a standard approach.
-        std::cout << "[Resize Start] New cap = " << new_capacity << std::endl;
-    
-        // Move the existing primary table's data to temporary table for resizing
-        temporary_table_.emplace(std::move(primary_table_)); 
-    
-        // Create a new primary table with the new doubled capacity
-        primary_table_ = HTable<K,V>(new_capacity); 
-    
+
+    // Shrinks to the capacity that puts the entries at half the maximum load, like a grow does, once they're down
+    // to an eighth of it. Caller holds map_mutex_ exclusively, with no migration running.
+    void start_shrink() {
+        Table* table = primary();
+        if (!table || table->capacity() <= Table::min_capacity) {
+            return;
+        }
+        if (static_cast<double>(table->size()) > table->capacity() * Table::max_load_factor / 8) {
+            return;
+        }
+        size_t wanted = static_cast<size_t>(table->size() * 2 / Table::max_load_factor) + 1;
+        size_t new_capacity = std::max(Table::min_capacity, std::bit_ceil(wanted));
+        if (new_capacity < table->capacity()) {
+            start_resize(new_capacity);
+        }
+    }
+
+    // Caller must hold map_mutex_ exclusively (insert does) - shared_mutex is not recursive.
+    // The old table is published as temporary_ before the new primary_, so a reader that sees the new primary
+    // also sees where the entries still are.
+    void start_resize(size_t new_capacity) {
+        assert(!temporary()); // First a sanity check that resizing table doesn't already exist!
+
+        Table* old = primary();
+        LOG_TRACE("[Resize Start] {} -> {}", old->capacity(), new_capacity);
+
+        temporary_.store(old, std::memory_order_release);
+        primary_.store(new Table(new_capacity), std::memory_order_release);
+
         resizing_pos_ = 0; // Set the position where we start migrating data from temporary table to primary table.
     }
-    
-    
+
+
 };
 
-#endif // HASH_TABLE_HPP
\ No newline at end of file
+#endif // HASH_TABLE_HPP
@@ -7,6 +7,8 @@
 #include <memory>
 #include <stdexcept>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 
 template<typename T>
 class HeapItem;
@@ -39,11 +41,11 @@ public:
     HeapItem<T> pop() { 
         std::unique_lock lock(heap_mutex_);        
 
-        if (empty()) {
+        if (items_.empty()) { // not empty()/size(), they'd take the lock we already hold
             throw std::out_of_range("Heap is empty");
         }
         HeapItem<T> result = std::move(items_[0]); // move our items_[0] to our result. Since we popped our element - we must 
-        if (size() > 1) {
+        if (items_.size() > 1) {
             items_[0] = std::move(items_.back());
             items_.pop_back();
             sift_down(0);
@@ -72,6 +74,25 @@ public:
         }
     }
 
+    // remove the item at pos (found through its position_ref), the last item takes its place and gets sifted
+    void erase(std::size_t pos) {
+        std::unique_lock lock(heap_mutex_);
+        if (pos >= items_.size()) {
+            throw std::out_of_range("erase: Position out of range");
+        }
+        if (pos + 1 == items_.size()) {
+            items_.pop_back();
+            return;
+        }
+        items_[pos] = std::move(items_.back());
+        items_.pop_back();
+        if (pos > 0 && compare_(items_[pos].value_, items_[parent(pos)].value_)) {
+            sift_up(pos);
+        } else {
+            sift_down(pos);
+        }
+    }
+
     void swap(std::size_t i, std::size_t j) {
         std::unique_lock lock(heap_mutex_);  
         if (i >= items_.size() || j >= items_.size()) {
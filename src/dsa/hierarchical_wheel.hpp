@@ -0,0 +1,154 @@
+#ifndef HIERARCHICAL_WHEEL_HPP
+#define HIERARCHICAL_WHEEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Hierarchical timing wheel keyed by millisecond deadline, for key TTLs.
+//
+// LEVELS wheels of SLOTS slots each. Level 0 has one slot per millisecond, each level above covers SLOTS times the
+// span of the one below (256ms, 65s, 4.6h, 49 days). A timer goes into the lowest level whose span still reaches
+// its deadline, at the slot given by the deadline's own bits for that level, so schedule/reschedule/cancel are a
+// list link or unlink - O(1) whatever the number of timers, unlike a heap. When level 0 wraps, the next slot of
+// level 1 is emptied into the levels below it (a "cascade"), and so on up. A timer moves down at most LEVELS - 1
+// times over its life, deadlines past the top level's span just stay at the top until they come into range.
+//
+// Unlike TimerWheel (connection idle timers, one wheel per reactor) a deadline here is exact: a timer fires on its
+// millisecond, never before. Not thread safe, the owner locks (EntryManager's write lock).
+template<typename T>
+class HierarchicalWheel {
+public:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+
+    class Node {
+    public:
+        explicit Node(T* owner = nullptr) noexcept : owner_(owner) {}
+        ~Node() { unlink(); }
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        [[nodiscard]] bool is_linked() const noexcept { return prev_ != nullptr; }
+        [[nodiscard]] uint64_t deadline() const noexcept { return deadline_; }
+
+    private:
+        T* owner_;
+        uint64_t deadline_{0};
+        Node* prev_{nullptr};
+        Node* next_{nullptr};
+        HierarchicalWheel* wheel_{nullptr};
+
+        void unlink() noexcept {
+            if (!prev_) return;
+            prev_->next_ = next_;
+            if (next_) next_->prev_ = prev_;
+            prev_ = next_ = nullptr;
+            wheel_->size_--;
+            wheel_ = nullptr;
+        }
+
+        friend class HierarchicalWheel;
+    };
+
+    explicit HierarchicalWheel(uint64_t now_ms = 0) noexcept : current_(now_ms) {}
+
+    HierarchicalWheel(const HierarchicalWheel&) = delete;
+    HierarchicalWheel& operator=(const HierarchicalWheel&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] uint64_t now() const noexcept { return current_; }
+
+    // also reschedules a linked node. A deadline already passed fires on the next advance.
+    void schedule(Node& node, uint64_t deadline_ms) noexcept {
+        node.unlink();
+        node.deadline_ = deadline_ms;
+        link(node);
+    }
+
+    void cancel(Node& node) noexcept { node.unlink(); }
+
+    // Fires every timer due by now_ms, at most max_expired of them: on_expire gets the owner after its node is
+    // unlinked and may destroy it. Stopping at the limit leaves the rest for the next call (including the rest of
+    // the slot it stopped in). Returns how many fired.
+    template<typename F>
+    size_t advance(uint64_t now_ms, size_t max_expired, F&& on_expire) {
+        size_t expired = 0;
+        while (current_ <= now_ms) {
+            // the current slot holds what came due this millisecond (or earlier, see link)
+            Node& head = wheels_[0][current_ & (SLOTS - 1)];
+            while (head.next_ && expired < max_expired) {
+                Node* node = head.next_;
+                node->unlink();
+                ++expired;
+                on_expire(*node->owner_);
+            }
+            if (expired >= max_expired || current_ >= now_ms) {
+                return expired;
+            }
+            if (size_ == 0) {  // nothing to walk past, just catch the clock up
+                current_ = now_ms;
+                return expired;
+            }
+            ++current_;
+            cascade();
+        }
+        return expired;  // now_ms is behind the wheel (another thread's older clock reading), nothing is due yet
+    }
+
+private:
+    std::array<std::array<Node, SLOTS>, LEVELS> wheels_;  // sentinels, only next_ is used
+    uint64_t current_;
+    size_t size_{0};
+
+    static constexpr uint64_t level_span(size_t level) noexcept { return uint64_t{1} << (SLOT_BITS * (level + 1)); }
+
+    void link(Node& node) noexcept {
+        uint64_t deadline = std::max(node.deadline_, current_);
+        uint64_t delta = deadline - current_;
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >= level_span(level)) {
+            ++level;
+        }
+        if (delta >= level_span(level)) {
+            deadline = current_ + level_span(level) - 1;  // beyond the top level: parked, re-linked when cascaded
+        }
+
+        Node& head = wheels_[level][(deadline >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        node.next_ = head.next_;
+        node.prev_ = &head;
+        if (head.next_) head.next_->prev_ = &node;
+        head.next_ = &node;
+        node.wheel_ = this;
+        size_++;
+    }
+
+    // current_ just moved onto a level boundary: empty the slot of each level that now comes into range,
+    // re-linking its nodes relative to current_ (they land in lower levels, or level 0's current slot)
+    void cascade() noexcept {
+        for (size_t level = 1; level < LEVELS; ++level) {
+            uint64_t below = level_span(level - 1) - 1;
+            if ((current_ & below) != 0) {
+                return;
+            }
+            Node& head = wheels_[level][(current_ >> (SLOT_BITS * level)) & (SLOTS - 1)];
+            Node* node = head.next_;
+            head.next_ = nullptr;
+            if (node) node->prev_ = nullptr;
+            while (node) {
+                Node* next = node->next_;
+                if (next) next->prev_ = nullptr;
+                node->prev_ = node->next_ = nullptr;
+                size_--;
+                link(*node);
+                node = next;
+            }
+        }
+    }
+};
+
+#endif // HIERARCHICAL_WHEEL_HPP
@@ -0,0 +1,133 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <sys/uio.h>
+
+// Growable byte ring used for a connection's read and write sides.
+//
+// head_ and tail_ only ever grow (the position in storage is & mask_), so consuming bytes is a counter bump -
+// nothing is shifted down after a frame is handled. The readable and writable regions are each at most two
+// segments, which is exactly what readv/writev want. When the ring drains it rewinds to offset 0, so in the
+// usual request/response rhythm frames never straddle the wrap; contiguous() fixes the rare one that does.
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t initial_capacity = 4096)
+        : capacity_(std::bit_ceil(std::max<size_t>(initial_capacity, 16))),
+          mask_(capacity_ - 1),
+          data_(std::make_unique_for_overwrite<uint8_t[]>(capacity_)) {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    RingBuffer(RingBuffer&&) noexcept = default;
+    RingBuffer& operator=(RingBuffer&&) noexcept = default;
+
+    [[nodiscard]] size_t size() const noexcept { return tail_ - head_; }
+    [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+    [[nodiscard]] size_t free_space() const noexcept { return capacity_ - size(); }
+    [[nodiscard]] bool empty() const noexcept { return head_ == tail_; }
+
+    // grows (doubling) until at least n more bytes fit, the live bytes are laid out from offset 0 afterwards
+    void reserve(size_t n) {
+        if (free_space() >= n) {
+            return;
+        }
+        size_t new_capacity = std::bit_ceil(size() + n);
+        auto grown = std::make_unique_for_overwrite<uint8_t[]>(new_capacity);
+        size_t live = size();
+        copy_out(grown.get(), live);
+        data_ = std::move(grown);
+        capacity_ = new_capacity;
+        mask_ = new_capacity - 1;
+        head_ = 0;
+        tail_ = live;
+    }
+
+    void append(const void* src, size_t n) {
+        reserve(n);
+        const auto* bytes = static_cast<const uint8_t*>(src);
+        size_t pos = tail_ & mask_;
+        size_t first = std::min(n, capacity_ - pos);
+        std::memcpy(data_.get() + pos, bytes, first);
+        std::memcpy(data_.get(), bytes + first, n - first);
+        tail_ += n;
+    }
+
+    void append(std::span<const uint8_t> bytes) { append(bytes.data(), bytes.size()); }
+
+    // readable bytes as up to two iovecs (for writev), returns how many were filled
+    int readable(iovec (&iov)[2]) noexcept {
+        return segments(head_, size(), iov);
+    }
+
+    // free space as up to two iovecs (for readv), follow with commit() for however much was written
+    int writable(iovec (&iov)[2]) noexcept {
+        return segments(tail_, free_space(), iov);
+    }
+
+    void commit(size_t n) noexcept { tail_ += n; }
+
+    void consume(size_t n) noexcept {
+        head_ += std::min(n, size());
+        if (head_ == tail_) {
+            head_ = tail_ = 0;  // rewind so the next burst starts at offset 0 and does not wrap
+        }
+    }
+
+    void clear() noexcept { head_ = tail_ = 0; }
+
+    // the first readable segment, i.e. what a single send() can take without copying
+    [[nodiscard]] std::span<const uint8_t> front() const noexcept {
+        size_t pos = head_ & mask_;
+        return {data_.get() + pos, std::min(size(), capacity_ - pos)};
+    }
+
+    // every readable byte as one span, rotating the storage first if the data wraps. The span is invalidated
+    // by the next append/reserve, consume only moves head_ and leaves it intact.
+    [[nodiscard]] std::span<const uint8_t> contiguous() {
+        size_t pos = head_ & mask_;
+        if (pos + size() > capacity_) {
+            std::rotate(data_.get(), data_.get() + pos, data_.get() + capacity_);  // in place, no allocation
+            tail_ = size();
+            head_ = 0;
+            pos = 0;
+        }
+        return {data_.get() + pos, size()};
+    }
+
+private:
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<uint8_t[]> data_;
+    size_t head_{0};
+    size_t tail_{0};
+
+    int segments(size_t start, size_t len, iovec (&iov)[2]) noexcept {
+        if (len == 0) {
+            return 0;
+        }
+        size_t pos = start & mask_;
+        size_t first = std::min(len, capacity_ - pos);
+        iov[0] = {data_.get() + pos, first};
+        if (first == len) {
+            return 1;
+        }
+        iov[1] = {data_.get(), len - first};
+        return 2;
+    }
+
+    void copy_out(uint8_t* dst, size_t n) const noexcept {
+        size_t pos = head_ & mask_;
+        size_t first = std::min(n, capacity_ - pos);
+        std::memcpy(dst, data_.get() + pos, first);
+        std::memcpy(dst + first, data_.get(), n - first);
+    }
+};
+
+#endif // RING_BUFFER_HPP
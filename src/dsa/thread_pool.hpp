@@ -4,6 +4,8 @@
 #include <functional>
 #include <future>
 #include <queue>
+#include <deque>
+#include <atomic>
 #include <thread>
 #include <vector>
 #include <memory>
@@ -73,7 +75,7 @@ public:
                 throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
             }
     
-            condition_.wait(lock, [this] { return !tasks_.empty() || stop.load(); });
+            tasks_.emplace_back([task] { (*task)(); }); // fix: actually queue the task (this used to wait for one instead)
         }
         
         condition_.notify_one();
@@ -123,7 +125,7 @@ void worker() {
             if (stop && tasks_.empty()) return; // exit only when tasks are completely finished
 
             task = std::move(tasks_.front());
-            tasks_.pop();
+            tasks_.pop_front();
             active_workers_.fetch_add(1, std::memory_order_relaxed); 
         } 
         task(); // execute task
@@ -0,0 +1,162 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <optional>
+#include <bit>
+#include <algorithm>
+
+// Hashed timing wheel: slot = deadline tick & mask, each slot an intrusive list of nodes.
+//
+// touch() only stores the new deadline - the node stays in the slot it is already in, and when the wheel reaches
+// that slot a node whose deadline has moved on is re-hashed instead of expired. So activity on a connection is a
+// single store, and a slot full of connections that went quiet together expires in one pass. Deadlines further out
+// than one revolution just get re-hashed again on the next lap.
+//
+// Single threaded by design (one wheel per reactor), nothing in here locks.
+template<typename T>
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Node {
+    public:
+        explicit Node(T* owner = nullptr) noexcept : owner_(owner) {}
+        ~Node() { unlink(); }
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        [[nodiscard]] bool is_linked() const noexcept { return prev_ != nullptr; }
+        [[nodiscard]] Clock::time_point deadline() const noexcept { return deadline_; }
+
+    private:
+        T* owner_;
+        Clock::time_point deadline_{};
+        Node* prev_{nullptr};
+        Node* next_{nullptr};
+        TimerWheel* wheel_{nullptr};
+
+        void unlink() noexcept {
+            if (!prev_) return;
+            prev_->next_ = next_;
+            if (next_) next_->prev_ = prev_;
+            prev_ = next_ = nullptr;
+            wheel_->size_--;
+            wheel_ = nullptr;
+        }
+
+        friend class TimerWheel;
+    };
+
+    TimerWheel(std::chrono::milliseconds tick, size_t slots, Clock::time_point now = Clock::now())
+        : tick_(tick), origin_(now), slots_(std::bit_ceil(std::max<size_t>(slots, 2))), mask_(slots_.size() - 1) {}
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    void schedule(Node& node, Clock::time_point deadline) noexcept {
+        node.unlink();
+        node.deadline_ = deadline;
+        link(node, std::max(tick_of(deadline), current_tick_ + 1));
+    }
+
+    // O(1), see above. Only a deadline that moves earlier has to be re-hashed right away.
+    void touch(Node& node, Clock::time_point deadline) noexcept {
+        if (!node.is_linked() || deadline < node.deadline_) {
+            schedule(node, deadline);
+            return;
+        }
+        node.deadline_ = deadline;
+    }
+
+    void cancel(Node& node) noexcept { node.unlink(); }
+
+    // Walks every slot between the last call and now. on_expire gets the owner after its node is unlinked and may
+    // destroy it (and its node). Returns how many expired.
+    template<typename F>
+    size_t advance(Clock::time_point now, F&& on_expire) {
+        uint64_t now_tick = tick_floor(now);
+        uint64_t last = std::min(now_tick, current_tick_ + slots_.size());  // a full lap visits every slot once
+        size_t expired = 0;
+
+        for (uint64_t t = current_tick_ + 1; t <= last; ++t) {
+            Node& head = slots_[t & mask_];
+            Node* node = head.next_;
+            head.next_ = nullptr;  // detach the slot so re-hashed nodes land in a fresh list, not this walk
+            if (node) node->prev_ = nullptr;
+
+            while (node) {
+                Node* next = node->next_;
+                if (next) next->prev_ = nullptr;
+                node->prev_ = node->next_ = nullptr;
+                node->wheel_ = nullptr;
+                size_--;
+
+                if (node->deadline_ <= now) {
+                    ++expired;
+                    on_expire(*node->owner_);
+                } else {
+                    link(*node, std::max(tick_of(node->deadline_), now_tick + 1));
+                }
+                node = next;
+            }
+        }
+        current_tick_ = std::max(current_tick_, now_tick);
+        return expired;
+    }
+
+    // how long until the next occupied slot is due, nullopt when nothing is scheduled
+    [[nodiscard]] std::optional<std::chrono::milliseconds> next_timeout(Clock::time_point now) const noexcept {
+        if (size_ == 0) {
+            return std::nullopt;
+        }
+        uint64_t t = current_tick_ + 1;
+        for (size_t i = 0; i < slots_.size() && !slots_[t & mask_].next_; ++i, ++t) {}
+
+        auto due = origin_ + tick_ * t;
+        if (due <= now) {
+            return std::chrono::milliseconds(0);
+        }
+        return std::chrono::ceil<std::chrono::milliseconds>(due - now);
+    }
+
+private:
+    std::chrono::milliseconds tick_;
+    Clock::time_point origin_;
+    std::vector<Node> slots_{};  // sentinels, only next_ is used
+    size_t mask_;
+    uint64_t current_tick_{0};
+    size_t size_{0};
+
+    // rounded up, a timer never fires before its deadline
+    [[nodiscard]] uint64_t tick_of(Clock::time_point deadline) const noexcept {
+        auto elapsed = deadline - origin_;
+        if (elapsed <= Clock::duration::zero()) return 0;
+        return static_cast<uint64_t>((elapsed + tick_ - Clock::duration(1)) / tick_);
+    }
+
+    [[nodiscard]] uint64_t tick_floor(Clock::time_point now) const noexcept {
+        auto elapsed = now - origin_;
+        if (elapsed <= Clock::duration::zero()) return 0;
+        return static_cast<uint64_t>(elapsed / tick_);
+    }
+
+    void link(Node& node, uint64_t tick) noexcept {
+        Node& head = slots_[tick & mask_];
+        node.next_ = head.next_;
+        node.prev_ = &head;
+        if (head.next_) head.next_->prev_ = &node;
+        head.next_ = &node;
+        node.wheel_ = this;
+        size_++;
+    }
+};
+
+#endif // TIMER_WHEEL_HPP
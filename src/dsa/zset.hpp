@@ -4,6 +4,7 @@
 #include "avl.hpp" // include the avl tree header file
 #include "hashtable.hpp" // include the custom hash table header file
 #include "thread_pool.hpp" // include the thread pool header file
+#include "../../logging.hpp"
 #include <memory> // include memory management utilities like unique_ptr
 #include <mutex>
 #include <future>
@@ -21,15 +22,16 @@ public:
 
     ZNode* lookup(std::string_view name) {
         std::shared_lock lock(zset_mutex_);
-        std::cerr << "Looking up: " << name << std::endl;
-        ZNode** node_ptr = hash.find(std::string(name));
-        return (node_ptr && *node_ptr) ? *node_ptr : nullptr;
+        return lookup_locked(name);
     }
+
+    // heap bytes held for the members, kept up to date by add/remove (EntryManager's memory accounting)
+    [[nodiscard]] size_t memory_usage() const noexcept { return memory_; }
     
     bool add_internal(std::string_view name, double score) {
         std::unique_lock lock(zset_mutex_);  
-        if (ZNode* node = lookup(name)) {
-            update_score(node, score);
+        if (ZNode* node = lookup_locked(name)) {
+            update_score_locked(node, score);
             return false;
         }
     
@@ -37,17 +39,18 @@ public:
         auto node = std::make_shared<ZNode>(std::string(name), score);
     
         if (node->get_key().empty()) {
-            std::cerr << "ERROR: Created node has empty key after construction!" << std::endl;
+            LOG_ERROR("Created node has empty key after construction!");
             return false;
         }
     
-        std::cerr << "Created node: " << node->get_key() << " with score: " << node->get_value() << std::endl;
+        LOG_TRACE("Created node: {} with score: {}", node->get_key(), node->get_value());
     
         nodes_.emplace_back(node);  
         hash.insert(node->get_key(), node.get()); 
         tree.set(node->get_key(), score);
+        memory_ += member_memory(node->get_key());
     
-        std::cerr << "Added node successfully: " << node->get_key() << std::endl;
+        LOG_TRACE("Added node successfully: {}", node->get_key());
         return true;
     }
     
@@ -61,11 +64,12 @@ public:
 
     ZNode* pop_internal(std::string_view name) {
         std::unique_lock lock(zset_mutex_);
-        ZNode** node_ptr = hash.find(std::string(name));
+        ZNode** node_ptr = hash.find(name);
         if (!node_ptr || !*node_ptr) return nullptr;
 
         ZNode* node = *node_ptr;
-        hash.remove(std::string(name));
+        memory_ -= member_memory(node->get_key());
+        hash.remove(name);
         tree.del(node->get_key());
         lock.unlock();
         {
@@ -79,37 +83,17 @@ public:
     
     bool update_score(ZNode* node, double new_score) {
         std::unique_lock lock(zset_mutex_);  
-        if (!node) {
-            std::cerr << "update_score: Received a nullptr!" << std::endl;
-            return false;
-        }
-    
-        std::string key = node->get_key();
-        if (key.empty()) {
-            std::cerr << "update_score: Node key is empty!" << std::endl;
-            return false;
-        }
-    
-        ZNode** node_ptr = hash.find(key);
-        if (!node_ptr || !*node_ptr) {
-            std::cerr << "update_score: Key not found in hash: " << key << std::endl;
-            return false; 
-        }
-    
-        tree.del(key);
-        node->set_value(new_score);
-        tree.set(key, new_score);
-        
-        return true; 
+        return update_score_locked(node, new_score);
     }
     
     bool remove_internal(std::string_view name) {
         std::unique_lock lock(zset_mutex_);
-        ZNode** node_ptr = hash.find(std::string(name));
+        ZNode** node_ptr = hash.find(name);
         if (!node_ptr || !*node_ptr) return false;
     
         ZNode* node = *node_ptr;
-        hash.remove(std::string(name));  
+        memory_ -= member_memory(node->get_key());
+        hash.remove(name);
         tree.del(node->get_key());
     
         nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(),
@@ -126,11 +110,54 @@ public:
     //     });
     // }
     
-    ZNode* query(double score, std::string_view name, int64_t offset) {
+    ZNode* query([[maybe_unused]] double score, std::string_view name, [[maybe_unused]] int64_t offset) {
         std::shared_lock lock(zset_mutex_);  
-        return tree.exists(std::string(name)) ? lookup(name) : nullptr;
+        return tree.exists(name) ? lookup_locked(name) : nullptr;
+    }
+
+private:
+    size_t memory_ = 0;
+
+    // a member is a shared ZNode (+ control block and its slot in nodes_), the tree's own node and a hash node,
+    // each with a copy of the name
+    static size_t member_memory(const std::string& name) noexcept {
+        return 2 * sizeof(ZNode) + 2 * sizeof(long) + sizeof(std::shared_ptr<ZNode>) + sizeof(HNode<std::string, ZNode*>) +
+               3 * string_heap_bytes(name.size());
     }
 
+    // callers hold zset_mutex_ (shared is enough for lookup_locked), it is not recursive
+    ZNode* lookup_locked(std::string_view name) {
+        LOG_TRACE("Looking up: {}", name);
+        ZNode** node_ptr = hash.find(name);
+        return (node_ptr && *node_ptr) ? *node_ptr : nullptr;
+    }
+
+    bool update_score_locked(ZNode* node, double new_score) {
+        if (!node) {
+            LOG_ERROR("update_score: Received a nullptr!");
+            return false;
+        }
+    
+        const std::string& key = node->get_key();  // the node outlives this call, no copy needed
+        if (key.empty()) {
+            LOG_ERROR("update_score: Node key is empty!");
+            return false;
+        }
+    
+        ZNode** node_ptr = hash.find(key);
+        if (!node_ptr || !*node_ptr) {
+            LOG_ERROR("update_score: Key not found in hash: {}", key);
+            return false; 
+        }
+    
+        tree.del(key);
+        node->set_value(new_score);
+        tree.set(key, new_score);
+        
+        return true; 
+    }
+
+public:
     ~ZSet() {
         hash.clear();  
         nodes_.clear();  
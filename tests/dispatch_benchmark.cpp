@@ -0,0 +1,70 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include "../command_processor.hpp"
+
+// Cost of finding the handler for a command name, per command: the perfect-hash slot table against the lowercased
+// std::string + std::unordered_map<std::string, std::function> lookup it replaced. Names are sent uppercase, the
+// way clients usually send them.
+
+constexpr size_t ITERATIONS = 10'000'000;
+
+using OldHandler = std::function<void(CommandProcessor::CommandContext)>;
+
+static const std::unordered_map<std::string, OldHandler>& old_handlers() {
+    static const std::unordered_map<std::string, OldHandler> handlers = [] {
+        std::unordered_map<std::string, OldHandler> map;
+        for (const auto& command : CommandProcessor::command_handlers) {
+            map.emplace(std::string(command.name), [](CommandProcessor::CommandContext) {});
+        }
+        return map;
+    }();
+    return handlers;
+}
+
+static const OldHandler* old_find(std::string_view name) {
+    std::string lowered(name);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) { return std::tolower(c); });
+    auto it = old_handlers().find(lowered);
+    return it == old_handlers().end() ? nullptr : &it->second;
+}
+
+template<typename Fn>
+void run_benchmark(const std::string& label, Fn&& fn) {
+    uintptr_t sink = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        sink += reinterpret_cast<uintptr_t>(fn());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    asm volatile("" : : "r"(sink));
+
+    std::cout << "[" << label << "] " << ITERATIONS << " ops in " << elapsed_ms << " ms ("
+              << (elapsed_ms * 1e6 / ITERATIONS) << " ns/op)\n";
+}
+
+int main() {
+    std::cout << "\n--- Command Dispatch Benchmarks (handler lookup per command) ---\n\n";
+
+    std::vector<std::string> names;
+    for (const auto& command : CommandProcessor::command_handlers) {
+        std::string upper(command.name);
+        std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+        names.push_back(upper);
+    }
+    names.push_back("UNKNOWN");
+
+    for (const auto& name : names) {
+        std::string_view view = name;
+        asm volatile("" : "+r"(view));  // keep the name opaque, or the whole lookup folds at compile time
+        run_benchmark(name + ", perfect hash", [&] { return CommandProcessor::find_handler(view); });
+        run_benchmark(name + ", unordered_map", [&] { return old_find(view); });
+    }
+    return 0;
+}
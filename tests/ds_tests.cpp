@@ -4,6 +4,8 @@
 AVL TREE TESTS
 */
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <unordered_set>
@@ -15,6 +17,25 @@ HASH TABLE TESTS
 
 #include "../src/hashtable.hpp"
 
+// Seeded: the same key hashes the same within a process whatever type it's held in, and differently under
+// another seed; every length takes its own path through the short/medium/long cases
+TEST(HashKeyTest, SeededAndConsistent) {
+    std::string key = "user:12345";
+    EXPECT_EQ(hash_key(key), hash_key(std::string_view(key)));
+    EXPECT_EQ(hash_key(key), hash_bytes(key.data(), key.size(), hash_seed()));
+    EXPECT_NE(hash_bytes(key.data(), key.size(), 1), hash_bytes(key.data(), key.size(), 2));
+
+    std::string bytes(200, 'x');
+    std::unordered_set<uint64_t> seen;
+    for (size_t len = 0; len <= bytes.size(); ++len) {
+        seen.insert(hash_key(bytes.data(), len));
+    }
+    EXPECT_EQ(seen.size(), bytes.size() + 1);
+
+    bytes[150] = 'y';  // a byte in the 48 byte lane loop changes the hash
+    EXPECT_NE(hash_key(bytes.data(), 199), hash_key(std::string(199, 'x').data(), 199));
+}
+
 // Test HTable insert and retrieval
 TEST(HTableTest, InsertAndGet) {
     HTable<int, std::string> table;
@@ -111,6 +132,431 @@ TEST(HMapTest, ResizeTest) {
     }
 }
 
+// Batched insert/find/remove, big enough to go through a resize
+TEST(HMapTest, BatchOps) {
+    HMap<std::string, int> map;
+
+    std::vector<std::pair<std::string, int>> items;
+    for (int i = 0; i < 500; i++) {
+        items.emplace_back("key" + std::to_string(i), i);
+    }
+    map.insert_many(std::move(items));
+    map.insert_many({{"late", -1}});
+    EXPECT_EQ(map.size(), 501);
+
+    std::vector<std::string_view> keys = {"key7", "missing", "key499", "late", "key7"};
+    std::vector<int*> found(keys.size());
+    map.find_many(std::span<const std::string_view>(keys), std::span(found));
+    ASSERT_NE(found[0], nullptr);
+    EXPECT_EQ(*found[0], 7);
+    EXPECT_EQ(found[1], nullptr);
+    EXPECT_EQ(*found[2], 499);
+    EXPECT_EQ(*found[3], -1);
+    EXPECT_EQ(found[4], found[0]);
+
+    std::vector<std::string_view> doomed = {"key7", "missing", "late"};
+    std::vector<std::optional<int>> removed(doomed.size());
+    map.remove_many(std::span<const std::string_view>(doomed), std::span(removed));
+    EXPECT_EQ(removed[0], 7);
+    EXPECT_FALSE(removed[1].has_value());
+    EXPECT_EQ(removed[2], -1);
+    EXPECT_EQ(map.size(), 499);
+    EXPECT_EQ(map.find(std::string_view("key7")), nullptr);
+    EXPECT_NE(map.find(std::string_view("key8")), nullptr);
+}
+
+// Lock-free readers alongside a writer growing the map through several migrations and a thread driving them with
+// rehash: a key that's never removed must never be missed, whichever table it's in or moving between
+TEST(HMapTest, ConcurrentReadsDuringResize) {
+    HMap<std::string, int> map;
+    for (int i = 0; i < 64; i++) {
+        map.insert("stable" + std::to_string(i), i);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> misses{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) {
+                    int* value = map.find(std::string_view("stable" + std::to_string(i)));
+                    if (!value || *value != i) misses++;
+                }
+            }
+        });
+    }
+
+    std::thread rehasher([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            map.rehash(std::chrono::steady_clock::now() + std::chrono::microseconds(100));
+        }
+    });
+
+    for (int i = 0; i < 20000; i++) {
+        map.insert("churn" + std::to_string(i), i);
+        if (i % 3 == 0) map.remove("churn" + std::to_string(i / 2));
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+    rehasher.join();
+
+    EXPECT_EQ(misses.load(), 0);
+    EXPECT_NE(map.find(std::string_view("churn19999")), nullptr);
+    map.clear();
+    EXPECT_EQ(map.find(std::string_view("stable1")), nullptr);
+    EXPECT_EQ(map.size(), 0);
+}
+
+// Inserts leave a grow's migration to rehash until the new table is under pressure, rehash finishes it within
+// its deadline a step at a time, and shrinks the table back once it's mostly empty
+TEST(HMapTest, BackgroundRehash) {
+    HMap<int, int> map(RehashMode::Background);
+    int n = 0;
+    while (!map.resizing() || map.capacity() < 1024) {  // the small early grows finish under pressure
+        map.insert(n, n);
+        n++;
+    }
+    size_t grown = map.capacity();
+    for (int i = 0; i < 10; i++, n++) {
+        map.insert(n, n);
+    }
+    EXPECT_TRUE(map.resizing());  // not under pressure yet, inserts didn't help
+
+    auto past = std::chrono::steady_clock::now();
+    EXPECT_TRUE(map.rehash(past));  // one step, then out of time
+    while (map.rehash(std::chrono::steady_clock::now() + std::chrono::seconds(1))) {}
+    EXPECT_FALSE(map.resizing());
+    EXPECT_EQ(map.capacity(), grown);
+
+    for (int i = 0; i < 100000; i++, n++) {  // grows through several migrations with nobody calling rehash
+        map.insert(n, n);
+    }
+    EXPECT_EQ(map.size(), static_cast<size_t>(n));
+    for (int i = 0; i < n; i += 97) {
+        ASSERT_NE(map.find(i), nullptr);
+    }
+
+    size_t big = map.capacity();
+    for (int i = 10; i < n; i++) {
+        map.remove(i);
+    }
+    EXPECT_EQ(map.capacity(), big);  // removes never shrink on their own
+    while (map.rehash(std::chrono::steady_clock::now() + std::chrono::seconds(1))) {}
+    EXPECT_LT(map.capacity(), big / 1000);
+    EXPECT_EQ(map.size(), 10);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_NE(map.find(i), nullptr);
+        EXPECT_EQ(*map.find(i), i);
+    }
+}
+
+// With nobody calling rehash (a ZSet's member map), inserts and removes move every migration along and a mass
+// remove shrinks the map
+TEST(HMapTest, ForegroundShrink) {
+    HMap<int, int> map;
+    for (int i = 0; i < 100000; i++) {
+        map.insert(i, i);
+    }
+    size_t big = map.capacity();
+    for (int i = 10; i < 100000; i++) {
+        map.remove(i);
+    }
+    EXPECT_LT(map.capacity(), big / 1000);
+    EXPECT_FALSE(map.resizing());
+    EXPECT_EQ(map.size(), 10);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_NE(map.find(i), nullptr);
+        EXPECT_EQ(*map.find(i), i);
+    }
+}
+
+#include "../src/flat_table.hpp"
+
+// The open-addressing backend behind the same HMap, through several migrations
+TEST(FlatTableTest, MapInsertFindRemove) {
+    HMap<std::string, int, FlatTable<std::string, int>> map;
+
+    for (int i = 0; i < 5000; i++) {
+        map.insert("key" + std::to_string(i), i);
+    }
+    EXPECT_EQ(map.size(), 5000);
+    for (int i = 0; i < 5000; i++) {
+        int* found = map.find(std::string_view("key" + std::to_string(i)));
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(*found, i);
+    }
+    EXPECT_EQ(map.find(std::string_view("missing")), nullptr);
+
+    for (int i = 0; i < 5000; i += 2) {
+        EXPECT_EQ(map.remove("key" + std::to_string(i)), i);
+    }
+    EXPECT_EQ(map.size(), 2500);
+    EXPECT_EQ(map.find(std::string_view("key10")), nullptr);
+    ASSERT_NE(map.find(std::string_view("key11")), nullptr);
+
+    std::vector<std::string_view> keys = {"key11", "key12", "key4999"};
+    std::vector<int*> found(keys.size());
+    map.find_many(std::span<const std::string_view>(keys), std::span(found));
+    EXPECT_EQ(*found[0], 11);
+    EXPECT_EQ(found[1], nullptr);
+    EXPECT_EQ(*found[2], 4999);
+}
+
+// Churn at a steady size leaves tombstones, which the table sweeps by rehashing in place rather than growing
+TEST(FlatTableTest, TombstonesAreSwept) {
+    FlatTable<int, int> table(64);
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 40; i++) {
+            table.insert(round * 40 + i, i);
+        }
+        for (int i = 0; i < 40; i++) {
+            ASSERT_EQ(table.remove(round * 40 + i), i);
+        }
+    }
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_EQ(table.capacity(), 64);
+    EXPECT_EQ(table.lookup(7), nullptr);
+
+    size_t pos = 0;
+    FlatTable<int, int> into;
+    table.insert(1, 10);
+    table.insert(2, 20);
+    EXPECT_EQ(table.migrate_to(into, pos, 15, 0), 0);  // out of slots to look at before finding either
+    EXPECT_EQ(table.migrate_to(into, pos, 15, table.capacity()), 2);
+    EXPECT_TRUE(table.empty());
+    ASSERT_NE(into.lookup(2), nullptr);
+    EXPECT_EQ(into.lookup(2)->value_, 20);
+}
+
+/*
+RING BUFFER TESTS
+*/
+
+#include "../src/ring_buffer.hpp"
+
+// Test append/consume through the wrap point
+TEST(RingBufferTest, WrapAround) {
+    RingBuffer ring(16);
+    const uint8_t first[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    ring.append(first, sizeof(first));
+    ring.consume(10);
+
+    const uint8_t second[8] = {12, 13, 14, 15, 16, 17, 18, 19};
+    ring.append(second, sizeof(second));  // 2 left + 8 new, crosses the end of a 16 byte ring
+    EXPECT_EQ(ring.capacity(), 16u);
+    EXPECT_EQ(ring.size(), 10u);
+
+    iovec iov[2] = {};
+    EXPECT_EQ(ring.readable(iov), 2);
+    EXPECT_EQ(iov[0].iov_len + iov[1].iov_len, 10u);
+
+    auto bytes = ring.contiguous();
+    ASSERT_EQ(bytes.size(), 10u);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        EXPECT_EQ(bytes[i], 10 + i);
+    }
+}
+
+// Test growth keeps the live bytes in order
+TEST(RingBufferTest, GrowPreservesOrder) {
+    RingBuffer ring(16);
+    std::vector<uint8_t> data(100);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i);
+
+    ring.append(data.data(), 10);
+    ring.consume(5);
+    ring.append(data.data() + 10, 90);
+    EXPECT_GE(ring.capacity(), 95u);
+
+    auto bytes = ring.contiguous();
+    ASSERT_EQ(bytes.size(), 95u);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        EXPECT_EQ(bytes[i], 5 + i);
+    }
+}
+
+// Test readv-style writes land where commit says
+TEST(RingBufferTest, WritableAndCommit) {
+    RingBuffer ring(16);
+    iovec iov[2];
+    ASSERT_EQ(ring.writable(iov), 1);
+    EXPECT_EQ(iov[0].iov_len, 16u);
+    std::memcpy(iov[0].iov_base, "hello", 5);
+    ring.commit(5);
+
+    auto front = ring.front();
+    EXPECT_EQ(std::string(front.begin(), front.end()), "hello");
+
+    ring.consume(5);
+    EXPECT_TRUE(ring.empty());
+    ASSERT_EQ(ring.writable(iov), 1);  // drained rings rewind to offset 0
+    EXPECT_EQ(iov[0].iov_len, 16u);
+}
+
+/*
+TIMER WHEEL TESTS
+*/
+
+#include "../src/timer_wheel.hpp"
+
+struct TimedItem {
+    explicit TimedItem(int i) : id(i) {}
+    int id;
+    TimerWheel<TimedItem>::Node node{this};
+};
+
+// Test timers expire together once their slot is due, never early
+TEST(TimerWheelTest, ExpiresInBulk) {
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    TimerWheel<TimedItem> wheel(milliseconds(10), 8, start);
+
+    std::vector<std::unique_ptr<TimedItem>> items;
+    for (int i = 0; i < 100; i++) {
+        items.push_back(std::make_unique<TimedItem>(i));
+        wheel.schedule(items.back()->node, start + milliseconds(25));
+    }
+    EXPECT_EQ(wheel.size(), 100u);
+    EXPECT_EQ(*wheel.next_timeout(start), milliseconds(30));
+
+    std::vector<int> expired;
+    auto collect = [&](TimedItem& item) { expired.push_back(item.id); };
+    EXPECT_EQ(wheel.advance(start + milliseconds(24), collect), 0u);
+    EXPECT_EQ(wheel.advance(start + milliseconds(30), collect), 100u);
+    EXPECT_EQ(expired.size(), 100u);
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_FALSE(wheel.next_timeout(start).has_value());
+}
+
+// Test touch pushes a deadline out without re-hashing, and the wheel re-hashes it when the old slot comes up
+TEST(TimerWheelTest, TouchDefersExpiry) {
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    TimerWheel<TimedItem> wheel(milliseconds(10), 8, start);
+
+    TimedItem quiet{1}, busy{2};
+    wheel.schedule(quiet.node, start + milliseconds(20));
+    wheel.schedule(busy.node, start + milliseconds(20));
+    wheel.touch(busy.node, start + milliseconds(200));  // further out than one lap
+
+    std::vector<int> expired;
+    auto collect = [&](TimedItem& item) { expired.push_back(item.id); };
+    EXPECT_EQ(wheel.advance(start + milliseconds(20), collect), 1u);
+    EXPECT_EQ(expired, std::vector<int>{1});
+    EXPECT_TRUE(busy.node.is_linked());
+
+    for (int ms = 30; ms < 200; ms += 10) {
+        EXPECT_EQ(wheel.advance(start + milliseconds(ms), collect), 0u);
+    }
+    EXPECT_EQ(wheel.advance(start + milliseconds(200), collect), 1u);
+    EXPECT_EQ(expired, (std::vector<int>{1, 2}));
+}
+
+// Test cancel and destruction both unlink
+TEST(TimerWheelTest, CancelAndDestroy) {
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    TimerWheel<TimedItem> wheel(milliseconds(10), 8, start);
+
+    TimedItem kept{1};
+    wheel.schedule(kept.node, start + milliseconds(50));
+    {
+        TimedItem gone{2};
+        wheel.schedule(gone.node, start + milliseconds(50));
+        EXPECT_EQ(wheel.size(), 2u);
+    }
+    EXPECT_EQ(wheel.size(), 1u);
+    wheel.cancel(kept.node);
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.advance(start + milliseconds(100), [](TimedItem&) { FAIL(); }), 0u);
+}
+
+#include <random>
+#include "../src/hierarchical_wheel.hpp"
+
+struct TtlItem {
+    uint64_t deadline = 0;
+    uint64_t fired_at = 0;
+    HierarchicalWheel<TtlItem>::Node node{this};
+};
+
+// Every timer fires exactly on its millisecond, across cascades from every level, with reschedules and cancels
+TEST(HierarchicalWheelTest, FiresOnDeadline) {
+    constexpr uint64_t start = 1'000'003;  // not on a level boundary
+    HierarchicalWheel<TtlItem> wheel(start);
+    std::mt19937_64 rng(42);
+    std::vector<TtlItem> items(5000);
+    for (auto& item : items) {
+        item.deadline = start + rng() % (uint64_t{1} << (8 * (1 + rng() % 3)));
+        wheel.schedule(item.node, item.deadline);
+    }
+    for (size_t i = 0; i < items.size(); i += 7) {  // reschedule some, later or earlier
+        items[i].deadline = start + 1 + rng() % 100'000;
+        wheel.schedule(items[i].node, items[i].deadline);
+    }
+    for (size_t i = 3; i < items.size(); i += 11) {
+        wheel.cancel(items[i].node);
+        items[i].deadline = 0;
+    }
+
+    uint64_t now = start;
+    while (!wheel.empty()) {
+        now += 1 + rng() % 50;
+        wheel.advance(now, SIZE_MAX, [&](TtlItem& item) { item.fired_at = now; });
+    }
+    for (const auto& item : items) {
+        if (item.deadline == 0) {
+            EXPECT_EQ(item.fired_at, 0u);
+        } else {
+            EXPECT_GE(item.fired_at, item.deadline);
+            EXPECT_LT(item.fired_at, item.deadline + 50);
+        }
+    }
+}
+
+// A limited advance stops mid-slot and the next call picks up the rest, a past deadline fires right away
+TEST(HierarchicalWheelTest, AdvanceLimitAndPastDeadlines) {
+    HierarchicalWheel<TtlItem> wheel(100);
+    std::vector<TtlItem> items(10);
+    for (auto& item : items) {
+        wheel.schedule(item.node, 150);
+    }
+    size_t fired = 0;
+    EXPECT_EQ(wheel.advance(200, 4, [&](TtlItem&) { fired++; }), 4u);
+    EXPECT_EQ(wheel.advance(200, 100, [&](TtlItem&) { fired++; }), 6u);
+    EXPECT_EQ(fired, 10u);
+
+    TtlItem late;
+    wheel.schedule(late.node, 10);
+    EXPECT_EQ(wheel.advance(150, 100, [&](TtlItem&) {}), 0u);  // behind the wheel: nothing moves
+    EXPECT_EQ(wheel.advance(200, 100, [&](TtlItem&) {}), 1u);
+    EXPECT_TRUE(wheel.empty());
+}
+
+/*
+THREAD POOL TESTS
+*/
+
+#include "../src/thread_pool.hpp"
+
+// Test enqueued tasks run and their futures resolve
+TEST(ThreadPoolTest, EnqueueRunsTasks) {
+    ThreadPool pool(4);
+    std::atomic<int> counter{0};
+    std::vector<std::future<int>> results;
+
+    for (int i = 0; i < 100; i++) {
+        results.push_back(pool.enqueue([&counter](int x) { counter++; return x * 2; }, i));
+    }
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(results[i].get(), i * 2);
+    }
+    pool.wait_for_tasks();
+    EXPECT_EQ(counter.load(), 100);
+    EXPECT_EQ(pool.queue_size(), 0u);
+}
+
 // /*
 //     Heap Test
 // */
@@ -594,3 +1040,423 @@ TEST(HMapTest, ResizeTest) {
 //     ZSet zset;
 //     EXPECT_EQ(zset.query(99.0, "Ghost", 0), nullptr);
 // }
+
+/*
+RESPONSE SERIALIZER TESTS
+*/
+
+#include "../response_serializer.hpp"
+
+TEST(ResponseSerializerTest, VarintRoundTrip) {
+    for (int64_t value : std::vector<int64_t>{0, 1, -1, 63, -64, 64, 300, -123456789, INT64_MAX, INT64_MIN}) {
+        std::vector<uint8_t> buffer;
+        ResponseSerializer::serialize_integer(buffer, value, ResponseFormat::V2);
+        EXPECT_EQ(ResponseSerializer::deserialize_integer(buffer, ResponseFormat::V2), value);
+    }
+
+    std::vector<uint8_t> small;
+    ResponseSerializer::serialize_integer(small, -1, ResponseFormat::V2);
+    EXPECT_EQ(small.size(), 2);  // type byte + one varint byte
+
+    std::vector<uint8_t> text;
+    ResponseSerializer::serialize_integer(text, -42);
+    EXPECT_EQ(ResponseSerializer::deserialize_integer(text), -42);
+}
+
+TEST(ResponseSerializerTest, StringsAndErrors) {
+    for (auto format : {ResponseFormat::V1, ResponseFormat::V2}) {
+        std::vector<uint8_t> str;
+        ResponseSerializer::serialize_bulk(str, std::string(1000, 'x'), format);
+        EXPECT_EQ(ResponseSerializer::deserialize_string(str, format), std::string(1000, 'x'));
+
+        std::vector<uint8_t> err;
+        ResponseSerializer::serialize_error(err, -3, "wrong type\n", format);
+        EXPECT_EQ(ResponseSerializer::deserialize_error(err, format), "wrong type\n");
+    }
+
+    std::vector<uint8_t> v2;
+    ResponseSerializer::serialize_bulk(v2, std::string(1000, 'x'), ResponseFormat::V2);
+    EXPECT_EQ(v2[0], static_cast<uint8_t>(SerializationType::Bulk));
+    EXPECT_EQ(v2.size(), 1 + 2 + 1000);
+}
+
+/*
+ZSET + ARGUMENT PARSING TESTS
+*/
+
+#include "../src/zset.hpp"
+#include "../arg_parser.hpp"
+
+// Test re-adding a member updates its score (add_internal used to deadlock on its own lock here)
+TEST(ZSetTest, AddUpdatesExistingMember) {
+    ZSet zset(1);
+    EXPECT_TRUE(zset.add_internal("Alice", 10.5));
+    EXPECT_FALSE(zset.add_internal("Alice", 15.0));
+    ASSERT_NE(zset.lookup("Alice"), nullptr);
+    EXPECT_EQ(zset.lookup("Alice")->get_value(), 15.0);
+    EXPECT_NE(zset.query(0, "Alice", 0), nullptr);
+    EXPECT_TRUE(zset.remove_internal("Alice"));
+    EXPECT_EQ(zset.lookup("Alice"), nullptr);
+}
+
+TEST(ArgParserTest, Numbers) {
+    int64_t i;
+    EXPECT_TRUE(ArgParser::parse_int("-42", i));
+    EXPECT_EQ(i, -42);
+    EXPECT_TRUE(ArgParser::parse_int("+7", i));
+    EXPECT_EQ(i, 7);
+    EXPECT_FALSE(ArgParser::parse_int("12x", i));
+    EXPECT_FALSE(ArgParser::parse_int("", i));
+    EXPECT_FALSE(ArgParser::parse_int("+-1", i));
+    EXPECT_FALSE(ArgParser::parse_int("99999999999999999999", i));
+
+    double d;
+    EXPECT_TRUE(ArgParser::parse_double("3.25", d));
+    EXPECT_EQ(d, 3.25);
+    EXPECT_TRUE(ArgParser::parse_double("1e3", d));
+    EXPECT_EQ(d, 1000.0);
+    EXPECT_TRUE(ArgParser::parse_double("+inf", d));
+    EXPECT_TRUE(std::isinf(d));
+    EXPECT_FALSE(ArgParser::parse_double("nan", d));
+    EXPECT_FALSE(ArgParser::parse_double(" 1", d));
+
+    std::vector<float> v = {9.0f};
+    EXPECT_TRUE(ArgParser::parse_float_array("0.5,-2,1e-3", v));
+    EXPECT_EQ(v, (std::vector<float>{9.0f, 0.5f, -2.0f, 1e-3f}));
+    EXPECT_FALSE(ArgParser::parse_float_array("1,,2", v));
+    EXPECT_EQ(v.size(), 4);
+}
+
+/*
+VALUE / ENTRY MANAGER TESTS
+*/
+
+#include "../entry_manager.hpp"
+
+// Each string picks the smallest encoding that gives the same bytes back
+TEST(ValueTest, StringEncodings) {
+    char scratch[Value::INT_DIGITS_MAX];
+
+    Value num = Value::string(std::string_view("-9223372036854775808"));
+    EXPECT_EQ(num.encoding(), ValueEncoding::Int);
+    EXPECT_EQ(num.str(scratch), "-9223372036854775808");
+    EXPECT_EQ(Value::string(std::string_view("007")).encoding(), ValueEncoding::Embedded);  // not canonical
+    EXPECT_EQ(Value::string(std::string_view("+7")).encoding(), ValueEncoding::Embedded);
+
+    Value small = Value::string(std::string_view("exactly16bytes!!"));
+    EXPECT_EQ(small.encoding(), ValueEncoding::Embedded);
+    EXPECT_EQ(small.str(scratch), "exactly16bytes!!");
+
+    Value big = Value::string(std::string(100, 'x'));
+    EXPECT_EQ(big.encoding(), ValueEncoding::Raw);
+    EXPECT_EQ(big.str(scratch), std::string(100, 'x'));
+    EXPECT_EQ(big.raw_string().use_count(), 1);
+
+    Value moved = std::move(big);
+    EXPECT_EQ(moved.str(scratch), std::string(100, 'x'));
+    EXPECT_EQ(big.encoding(), ValueEncoding::Embedded);
+    EXPECT_TRUE(big.str(scratch).empty());
+    EXPECT_FALSE(moved.is_zset());
+    EXPECT_EQ(moved.zset(), nullptr);
+}
+
+TEST(EntryManagerTest, OverwriteAndTtl) {
+    EntryManager entry_manager(1);
+    char scratch[Value::INT_DIGITS_MAX];
+
+    entry_manager.create_entry("a", Value::string(std::string_view("1")));
+    entry_manager.create_entry("b", Value::zset(std::make_unique<ZSet>()));
+    ASSERT_NE(entry_manager.find_entry("b"), nullptr);
+    EXPECT_NE(entry_manager.find_entry("b")->zset(), nullptr);
+
+    EXPECT_TRUE(entry_manager.set_entry_ttl("a", 60'000));
+    EXPECT_TRUE(entry_manager.set_entry_ttl("b", 30'000));
+    EXPECT_FALSE(entry_manager.set_entry_ttl("missing", 1000));
+    EXPECT_GT(entry_manager.get_expiry_time("a"), 30'000);
+    EXPECT_EQ(entry_manager.get_expiry_time("missing"), -2);
+
+    // deleting b has to drop b's deadline, not whichever is first in the heap
+    EXPECT_TRUE(entry_manager.delete_entry("b"));
+    EXPECT_GT(entry_manager.get_expiry_time("a"), 30'000);
+
+    // overwriting replaces the value in place and clears the TTL
+    Value* before = entry_manager.find_entry("a");
+    entry_manager.create_entry("a", Value::string(std::string_view("two")));
+    EXPECT_EQ(entry_manager.find_entry("a"), before);
+    EXPECT_EQ(entry_manager.find_entry("a")->str(scratch), "two");
+    EXPECT_EQ(entry_manager.get_expiry_time("a"), -1);
+
+    // repeated keys in one batch keep the last value
+    entry_manager.create_entries([] {
+        std::vector<std::pair<std::string, Value>> items;
+        items.emplace_back("a", Value::string(std::string_view("x")));
+        items.emplace_back("c", Value::string(std::string_view("y")));
+        items.emplace_back("c", Value::string(std::string_view("z")));
+        return items;
+    }());
+    EXPECT_EQ(entry_manager.find_entry("a")->str(scratch), "x");
+    EXPECT_EQ(entry_manager.find_entry("c")->str(scratch), "z");
+    std::vector<std::string_view> keys = {"a", "c", "c"};
+    EXPECT_EQ(entry_manager.delete_entries(keys), 2);
+}
+
+// A TTL whose usec deadline overflows an int64 saturates rather than wrapping into the past
+TEST(EntryManagerTest, HugeTtl) {
+    EntryManager entry_manager(1);
+    for (int64_t ttl_ms : {INT64_MAX / 1000 + 1, INT64_MAX}) {
+        entry_manager.create_entry("k", Value::string(std::string_view("v")));
+        EXPECT_TRUE(entry_manager.set_entry_ttl("k", ttl_ms));
+        EXPECT_EQ(entry_manager.expire_due(get_monotonic_usec(), std::chrono::seconds(1)), 0);
+        EXPECT_NE(entry_manager.find_entry("k"), nullptr);
+        EXPECT_GT(entry_manager.get_expiry_time("k"), INT64_MAX / 1000 - get_monotonic_usec() / 1000 - 1000);
+    }
+}
+
+// Active expiry deletes due keys in batches, stopping once the budget is spent
+TEST(EntryManagerTest, ExpireDue) {
+    EntryManager entry_manager(1);
+    for (int i = 0; i < 200; ++i) {
+        std::string key = "k" + std::to_string(i);
+        entry_manager.create_entry(key, Value::string(std::string_view("v")));
+        entry_manager.set_entry_ttl(key, i < 150 ? 1 : 60'000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // past its deadline a key is gone to readers before anything reclaims it
+    EXPECT_EQ(entry_manager.find_entry("k0"), nullptr);
+    EXPECT_EQ(entry_manager.get_expiry_time("k0"), -2);
+    EXPECT_NE(entry_manager.find_entry("k199"), nullptr);
+
+    EXPECT_EQ(entry_manager.expire_due(get_monotonic_usec(), std::chrono::microseconds(0)), EntryManager::EXPIRE_BATCH);
+    EXPECT_EQ(entry_manager.expire_due(get_monotonic_usec(), std::chrono::seconds(1)), 150 - EntryManager::EXPIRE_BATCH);
+    EXPECT_EQ(entry_manager.expire_due(get_monotonic_usec(), std::chrono::seconds(1)), 0);
+    EXPECT_EQ(entry_manager.expiry_stats().expired_keys, 150);
+    EXPECT_EQ(entry_manager.expiry_stats().cycles, 3);
+    EXPECT_FALSE(entry_manager.delete_entry("k10"));
+    EXPECT_TRUE(entry_manager.delete_entry("k160"));
+    EXPECT_GT(entry_manager.get_expiry_time("k199"), 0);
+}
+
+// Past max_memory a write evicts sampled keys until it's back under, or is refused under noeviction
+TEST(EntryManagerTest, Eviction) {
+    EntryManager entry_manager(1);
+    std::string big(1000, 'x');
+    for (int i = 0; i < 100; ++i) {
+        entry_manager.create_entry("k" + std::to_string(i), Value::string(std::string_view(big)));
+    }
+    size_t full = entry_manager.memory_stats().used_memory;
+    EXPECT_GT(full, 100 * big.size());
+
+    // accounting is symmetric: deleting everything gets back to zero
+    Value& zset = entry_manager.create_entry("z", Value::zset(std::make_unique<ZSet>()));
+    size_t before = zset.memory_usage();
+    zset.zset()->add_internal("a member name longer than the small string buffer", 1.0);
+    entry_manager.note_resize("z", before, zset.memory_usage());
+    EXPECT_GT(zset.memory_usage(), before);
+    EXPECT_TRUE(entry_manager.delete_entry("z"));
+    EXPECT_EQ(entry_manager.memory_stats().used_memory, full);
+
+    entry_manager.set_memory_limits({full / 2, EvictionPolicy::NoEviction});
+    EXPECT_FALSE(entry_manager.make_room("k0"));
+
+    entry_manager.set_memory_limits({full / 2, EvictionPolicy::VolatileTtl});
+    EXPECT_FALSE(entry_manager.make_room("k0"));  // no key has a TTL
+    entry_manager.set_entry_ttl("k1", 60'000);
+    entry_manager.set_entry_ttl("k2", 1'000);
+    entry_manager.set_memory_limits({entry_manager.memory_stats().used_memory - 1, EvictionPolicy::VolatileTtl});
+    EXPECT_TRUE(entry_manager.make_room("k0"));
+    EXPECT_EQ(entry_manager.find_entry("k2"), nullptr);  // soonest deadline first
+    EXPECT_NE(entry_manager.find_entry("k1"), nullptr);
+
+    entry_manager.set_memory_limits({full / 2, EvictionPolicy::AllKeysLru});
+    while (entry_manager.memory_stats().used_memory > full / 2) {
+        ASSERT_TRUE(entry_manager.make_room("k0"));
+    }
+    EXPECT_GE(entry_manager.memory_stats().evicted_keys, 50);
+
+    EXPECT_TRUE(entry_manager.clear_all());
+    EXPECT_EQ(entry_manager.memory_stats().used_memory, 0);
+}
+
+// Keys spread over the shards, batches split by shard and put back in the caller's order
+TEST(EntryManagerTest, Shards) {
+    EntryManager entry_manager(1, 6);
+    EXPECT_EQ(entry_manager.shard_count(), 8);
+    char scratch[Value::INT_DIGITS_MAX];
+
+    std::vector<std::string> names;
+    std::vector<size_t> per_shard(entry_manager.shard_count());
+    for (int i = 0; i < 1000; ++i) {
+        names.push_back("key:" + std::to_string(i));
+        per_shard[entry_manager.shard_of(names.back())]++;
+    }
+    for (size_t count : per_shard) {
+        EXPECT_GT(count, 60);
+    }
+
+    std::vector<std::pair<std::string, Value>> items;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back(names[i], Value::string(std::string_view(std::to_string(i))));
+    }
+    items.emplace_back(names[7], Value::string(std::string_view("last")));
+    entry_manager.create_entries(std::move(items));
+
+    std::vector<std::string_view> keys(names.begin(), names.begin() + 101);  // the last one was never set
+    auto values = entry_manager.find_entries(keys);
+    ASSERT_EQ(values.size(), 101);
+    EXPECT_EQ(values[3]->str(scratch), "3");
+    EXPECT_EQ(values[7]->str(scratch), "last");
+    EXPECT_EQ(values[100], nullptr);
+
+    {
+        std::vector<std::string_view> pair = {names[1], names[2]};
+        auto locks = entry_manager.lock_keys(pair, 1, true);
+        EXPECT_TRUE(entry_manager.delete_entry(names[1]));
+    }
+    EXPECT_EQ(entry_manager.delete_entries(keys), 99);
+    {
+        auto locks = entry_manager.lock_all(true);
+        EXPECT_TRUE(entry_manager.clear_all());
+    }
+}
+
+// The rehash cycle shrinks emptied shard tables, and keeps reporting work until it's done
+TEST(EntryManagerTest, RehashCycle) {
+    EntryManager entry_manager(1, 4);
+    std::vector<std::string> names;
+    for (int i = 0; i < 20000; ++i) {
+        names.push_back("key:" + std::to_string(i));
+        entry_manager.create_entry(names.back(), Value::string(std::string_view("v")));
+    }
+    std::vector<std::string_view> doomed(names.begin() + 5, names.end());
+    EXPECT_EQ(entry_manager.delete_entries(doomed), 19995);
+
+    EXPECT_TRUE(entry_manager.rehash(std::chrono::microseconds(0)));  // starts the shrinks, can't finish them
+    size_t cycles = 1;
+    while (entry_manager.rehash(std::chrono::milliseconds(10))) {
+        cycles++;
+    }
+    EXPECT_LT(cycles, 100);
+    EXPECT_FALSE(entry_manager.rehash(std::chrono::milliseconds(10)));
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_NE(entry_manager.find_entry(names[i]), nullptr);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    entry_manager.run_rehash_cycle(now, true);
+    EXPECT_GT(entry_manager.next_rehash_timeout(now).count(), 1);  // nothing pending, back to the slow check
+}
+
+/*
+REACTOR TESTS
+*/
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../reactor.hpp"
+
+// The client hangs up while its batch is on the pool, so one epoll_wait returns the offload eventfd (ready first)
+// and the connection's hang-up. Completing the batch closes the connection, and the loop must not then touch it
+// through the later event (ASan catches that).
+TEST(ReactorTest, HangUpWhileBatchOffloaded) {
+    EntryManager entry_manager(1);
+    CommandProcessor command_processor;
+    std::atomic<bool> should_stop{false};
+    ThreadPool pool(1);
+    Reactor reactor(0, IoBackend::Epoll, false, entry_manager, command_processor, should_stop, {},
+                    ExecutionMode::Offload, &pool);
+    ASSERT_TRUE(reactor.initialize());
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    Socket server_side(fds[0]);
+    ASSERT_TRUE(server_side.set_nonblocking());
+    reactor.add_connection(std::make_unique<Connection>(std::move(server_side), entry_manager, command_processor,
+                                                        ConnectionLimits{}, reactor.offloader_.get()));
+
+    const char request[] = "GET key\n";
+    ASSERT_EQ(write(fds[1], request, sizeof(request) - 1), static_cast<ssize_t>(sizeof(request) - 1));
+    reactor.epoll_once(0);  // read and offloaded
+    pool.wait_for_tasks();  // the eventfd is ready before the hang-up
+    close(fds[1]);
+
+    reactor.epoll_once(0);
+    EXPECT_TRUE(reactor.connections_.empty());
+}
+
+/*
+ALLOCATION TESTS
+*/
+
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include "../command_processor.hpp"
+
+// Every operator new in the test binary goes through here, counted while a test has armed the counter. The whole
+// family is replaced (the nothrow forms call these), so whichever form allocates, its delete frees with free().
+// The deletes stay out of line: inlined, GCC sees free() on what a new-expression returned (-Wmismatched-new-delete).
+static thread_local bool count_allocations = false;
+static thread_local size_t allocations = 0;
+
+static void* counted_alloc(size_t size, size_t alignment) {
+    if (count_allocations) ++allocations;
+    size = size ? size : 1;
+    void* ptr = alignment > alignof(std::max_align_t)
+                    ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                    : std::malloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size) { return counted_alloc(size, 0); }
+void* operator new[](size_t size) { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+static size_t allocations_during(const std::function<void()>& fn) {
+    allocations = 0;
+    count_allocations = true;
+    fn();
+    count_allocations = false;
+    return allocations;
+}
+
+// GET and ZREM look their keys (and the member) up by the argument's std::string_view, no std::string is built
+// on the way to the keyspace shard, its map, or the zset's hash and tree
+TEST(AllocationTest, GetAndZremByView) {
+    EntryManager entry_manager(1, 4);
+    entry_manager.create_entry("user:0000000000001", Value::string(std::string_view("value")));
+    auto zset = std::make_unique<ZSet>(1);
+    zset->add_internal("alice@example.com", 1.0);
+    zset->add_internal("bob@example.com.au", 2.0);
+    entry_manager.create_entry("leaderboard:global", Value::zset(std::move(zset)));
+
+    std::vector<uint8_t> response;
+    response.reserve(256);
+    auto run = [&](std::string_view command, std::string_view key, std::string_view member = {}) {
+        CommandArgs args;
+        args.push_back(command);
+        args.push_back(key);
+        if (!member.empty()) args.push_back(member);
+        response.clear();
+        return allocations_during([&] { CommandProcessor::process_command({args, response, entry_manager}); });
+    };
+
+    run("ZREM", "leaderboard:global", "nobody@example.com");  // the first lookup on a thread sets up its epoch record
+    EXPECT_EQ(run("GET", "user:0000000000001"), 0);
+    EXPECT_FALSE(response.empty());
+    EXPECT_EQ(run("GET", "user:0000000000002"), 0);
+    EXPECT_EQ(run("ZREM", "leaderboard:global", "alice@example.com"), 0);
+    EXPECT_EQ(run("ZREM", "leaderboard:global", "carol@example.com"), 0);
+    EXPECT_EQ(entry_manager.find_entry("leaderboard:global")->zset()->lookup("alice@example.com"), nullptr);
+    EXPECT_NE(entry_manager.find_entry("leaderboard:global")->zset()->lookup("bob@example.com.au"), nullptr);
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <malloc.h>
+#include "../src/hashtable.hpp"
+#include "../src/flat_table.hpp"
+
+// HMap over the chained HTable against HMap over FlatTable, string keys to uint64_t: insert (through the
+// incremental resizes), lookups that hit, lookups that miss, and heap bytes per key.
+// Pass key counts to try bigger sets, e.g. ./flat_table_benchmark 1000000 10000000 50000000.
+
+// heap bytes in use (glibc), including mmapped blocks - a big flat slot array is one of those
+static size_t allocated_bytes() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template<typename Map>
+void run_benchmark(const char* label, const std::vector<std::string>& keys, const std::vector<std::string>& misses) {
+    size_t num_keys = keys.size();
+    Map map;
+    size_t before = allocated_bytes();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_keys; ++i) {
+        map.insert(keys[i], i);
+    }
+    auto inserted = std::chrono::high_resolution_clock::now();
+    size_t after = allocated_bytes();
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+        const uint64_t* value = map.find(std::string_view(keys[(i * 7919) % num_keys]));  // strided, not insertion order
+        sum += value ? *value : 0;
+    }
+    auto hits = std::chrono::high_resolution_clock::now();
+
+    size_t found = 0;
+    for (const auto& key : misses) {
+        found += map.find(std::string_view(key)) != nullptr;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto ns_per_op = [](auto from, auto to, size_t ops) {
+        return std::chrono::duration<double, std::nano>(to - from).count() / ops;
+    };
+    std::cout << "[" << label << "] " << num_keys << " keys, " << (after - before) / num_keys << " bytes/key, insert "
+              << ns_per_op(start, inserted, num_keys) << " ns, hit " << ns_per_op(inserted, hits, num_keys) << " ns, miss "
+              << ns_per_op(hits, end, misses.size()) << " ns (checksum " << sum << ", " << found << " false hits)\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::stoull(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {1'000'000};
+    }
+
+    std::cout << "\n--- HMap Backend Benchmarks (string keys) ---\n\n";
+    for (size_t num_keys : sizes) {
+        std::vector<std::string> keys, misses;
+        keys.reserve(num_keys);
+        for (size_t i = 0; i < num_keys; ++i) {
+            keys.push_back("user:" + std::to_string(i));
+        }
+        for (size_t i = 0; i < std::min<size_t>(num_keys, 1'000'000); ++i) {
+            misses.push_back("absent:" + std::to_string(i));
+        }
+
+        run_benchmark<HMap<std::string, uint64_t>>("chained HTable", keys, misses);
+        run_benchmark<HMap<std::string, uint64_t, FlatTable<std::string, uint64_t>>>("FlatTable", keys, misses);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../src/hashtable.hpp"
+
+// hash_key throughput by key length: the FNV-1a it used to be (byte at a time, unseeded) against the seeded
+// wyhash that replaced it. Each length hashes a ring of distinct keys so the loop can't be folded away.
+
+constexpr size_t BYTES_PER_RUN = 256 << 20;
+constexpr size_t RING = 1024;
+
+static uint64_t fnv1a(const void* data, size_t len) noexcept {
+    uint64_t hash = 0xCBF29CE484222325;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+template<typename F>
+void run_benchmark(const char* label, size_t len, const std::vector<std::string>& keys, F&& hash) {
+    size_t ops = BYTES_PER_RUN / len;
+    uint64_t sink = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        sink += hash(keys[i % RING].data(), len);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "[" << label << "] " << len << " bytes: " << (ops * len / seconds) / 1e9 << " GB/s, "
+              << (seconds * 1e9 / ops) << " ns/key (" << (sink & 0xF) << ")\n";
+}
+
+int main() {
+    std::cout << "\n--- Key Hash Benchmarks ---\n\n";
+    for (size_t len : {8, 16, 32, 64, 128, 256, 512, 1024}) {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < RING; ++i) {
+            std::string key = "key:" + std::to_string(i * 2654435761u);
+            key.resize(len, static_cast<char>('a' + i % 26));
+            keys.push_back(std::move(key));
+        }
+        run_benchmark("FNV-1a", len, keys, fnv1a);
+        run_benchmark("wyhash", len, keys, [](const void* data, size_t n) { return hash_key(data, n); });
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../src/hashtable.hpp"
+#include "../src/flat_table.hpp"
+
+// Read-heavy HMap throughput from 1 to 32 threads (or the given max): the chained HTable backend, whose finds
+// take no lock (epoch-pinned), against FlatTable, whose finds share the map lock. Every thread only reads, plus
+// a run where one more thread keeps inserting and removing keys, pushing the map through migrations.
+// This is bare HMap::find, not GET: the keyspace shard's shared lock a GET also takes isn't in the loop.
+// Pass the key count and max thread count to change them, e.g. ./hmap_read_benchmark 1000000 64.
+
+constexpr size_t OPS_PER_THREAD = 2'000'000;
+
+static std::atomic<uint64_t> checksum{0};  // so the finds can't be optimised away
+
+template<typename Map>
+double run(Map& map, const std::vector<std::string>& keys, size_t threads, bool with_writer) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            uint64_t sum = 0;
+            while (!go.load(std::memory_order_acquire)) {}
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                const uint64_t* value = map.find(std::string_view(keys[(i * 7919 + t * 104729) % keys.size()]));
+                sum += value ? *value : 0;
+            }
+            checksum += sum;
+        });
+    }
+    std::thread writer;
+    if (with_writer) {
+        writer = std::thread([&] {
+            while (!go.load(std::memory_order_acquire)) {}
+            for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                map.insert("churn:" + std::to_string(i), i);
+                if (i >= 1000) map.remove("churn:" + std::to_string(i - 1000));
+            }
+        });
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    stop = true;
+    if (writer.joinable()) writer.join();
+
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    return threads * OPS_PER_THREAD / elapsed;
+}
+
+template<typename Map>
+void run_benchmark(const char* label, const std::vector<std::string>& keys, size_t max_threads) {
+    for (bool with_writer : {false, true}) {
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            Map map;
+            for (size_t i = 0; i < keys.size(); ++i) map.insert(keys[i], i);
+            double ops = run(map, keys, threads, with_writer);
+            std::cout << "[" << label << ", " << threads << " threads" << (with_writer ? " + writer" : "") << "] "
+                      << ops / 1e6 << " M finds/sec (checksum " << checksum.exchange(0) << ")\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    size_t max_threads = argc > 2 ? std::stoull(argv[2]) : 32;
+
+    std::vector<std::string> keys;
+    keys.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        keys.push_back("user:" + std::to_string(i));
+    }
+
+    std::cout << "\n--- HMap Concurrent Read Benchmarks (" << num_keys << " keys) ---\n\n";
+    run_benchmark<HMap<std::string, uint64_t>>("HTable, lock-free finds", keys, max_threads);
+    run_benchmark<HMap<std::string, uint64_t, FlatTable<std::string, uint64_t>>>("FlatTable, shared lock", keys, max_threads);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include "../entry_manager.hpp"
+#include "../response_serializer.hpp"
+
+// Bytes per key and GET lookup + reply cost for a keyspace of small string values: Value stored inline in the hash
+// node against the old layout (a shared_ptr to a virtual Entry<std::string> that keeps its own copy of the key).
+// Pass the key count to try a bigger dataset, e.g. ./keyspace_benchmark 10000000.
+
+struct OldEntryBase {
+    virtual ~OldEntryBase() = default;
+    size_t heap_idx = static_cast<size_t>(-1);
+    std::string key;
+};
+
+struct OldStringEntry : OldEntryBase {
+    std::string value;
+    OldStringEntry(std::string k, std::string v) : value(std::move(v)) { key = std::move(k); }
+};
+
+// heap bytes in use (glibc), RSS would hide the second run behind memory the first one freed
+static size_t allocated_bytes() {
+    return mallinfo2().uordblks;
+}
+
+static std::string key_for(size_t i) { return "user:" + std::to_string(i); }
+static std::string value_for(size_t i) { return i % 2 ? std::to_string(i * 7) : "v" + std::to_string(i); }
+
+template<typename Fill, typename Get>
+void run_benchmark(const char* label, size_t num_keys, Fill&& fill, Get&& get) {
+    size_t before = allocated_bytes();
+    fill();
+    size_t after = allocated_bytes();
+
+    size_t hits = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_keys; ++i) {
+        hits += get((i * 7919) % num_keys);  // strided, not sequential, so it isn't just walking the allocator
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "[" << label << "] " << num_keys << " keys, " << (after - before) / num_keys << " bytes/key, "
+              << num_keys << " GETs in " << elapsed_ms << " ms (" << (elapsed_ms * 1e6 / num_keys) << " ns/op, "
+              << hits << " hits)\n";
+}
+
+int main(int argc, char** argv) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    std::vector<std::string> keys;
+    keys.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        keys.push_back(key_for(i));
+    }
+
+    std::vector<uint8_t> response;
+    response.reserve(64);
+
+    std::cout << "\n--- Keyspace Benchmarks (small string values) ---\n\n";
+    {
+        HMap<std::string, std::shared_ptr<OldEntryBase>> db;
+        run_benchmark("shared_ptr<EntryBase>", num_keys,
+            [&] {
+                for (size_t i = 0; i < num_keys; ++i) {
+                    auto entry = std::make_shared<OldStringEntry>(keys[i], value_for(i));
+                    db.insert(entry->key, entry);
+                }
+            },
+            [&](size_t i) {
+                auto* found = db.find(std::string_view(keys[i]));
+                if (!found) return false;
+                auto entry = std::dynamic_pointer_cast<OldStringEntry>(*found);  // copies the shared_ptr, like GET did
+                if (!entry) return false;
+                response.clear();
+                ResponseSerializer::serialize_bulk(response, entry->value);
+                return true;
+            });
+    }
+    {
+        EntryManager entry_manager(1);
+        run_benchmark("Value", num_keys,
+            [&] {
+                for (size_t i = 0; i < num_keys; ++i) {
+                    entry_manager.create_entry(keys[i], Value::string(value_for(i)));
+                }
+            },
+            [&](size_t i) {
+                Value* value = entry_manager.find_entry(keys[i]);
+                if (!value || !value->is_string()) return false;
+                char scratch[Value::INT_DIGITS_MAX];
+                response.clear();
+                ResponseSerializer::serialize_bulk(response, value->str(scratch));
+                return true;
+            });
+    }
+    return 0;
+}
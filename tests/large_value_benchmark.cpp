@@ -0,0 +1,80 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../output_queue.hpp"
+#include "../response_serializer.hpp"
+
+// Serializes the same stored value as a GET reply and flushes it through an OutputQueue into a socketpair,
+// once copying the value into the reply (serialize_bulk) and once by reference (serialize_bulk_ref + iovec).
+
+constexpr size_t BYTES_PER_RUN = size_t{2} << 30;
+constexpr size_t VALUE_SIZES[] = {4096, 65536, 1 << 20};
+
+void drain(int fd) {
+    std::vector<char> sink(1 << 20);
+    while (read(fd, sink.data(), sink.size()) > 0) {}
+}
+
+void flush(int fd, OutputQueue& queue) {
+    iovec iov[64];
+    while (!queue.empty()) {
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(queue.gather(iov, 64));
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        queue.consume(static_cast<size_t>(n));
+    }
+}
+
+void run_benchmark(size_t value_size, bool by_reference, std::ostream& report) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        std::cerr << "socketpair failed\n";
+        return;
+    }
+    std::thread reader(drain, fds[1]);
+
+    auto value = std::make_shared<const std::string>(value_size, 'v');
+    OutputQueue queue;
+    std::vector<uint8_t> reply;
+    std::vector<ValueRef> refs;
+    size_t ops = BYTES_PER_RUN / value_size;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        reply.clear();
+        if (by_reference) {
+            ResponseSerializer::serialize_bulk_ref(reply, &refs, value, *value);
+        } else {
+            ResponseSerializer::serialize_bulk(reply, *value);
+        }
+        queue.append(reply, refs);
+        refs.clear();
+        flush(fds[0], queue);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    close(fds[0]);
+    reader.join();
+    close(fds[1]);
+
+    report << "[" << (by_reference ? "iovec" : "copy ") << " " << value_size << "B] " << ops << " ops in "
+           << elapsed_ms << " ms (" << (ops / (elapsed_ms / 1000.0)) << " ops/sec, "
+           << (BYTES_PER_RUN / (elapsed_ms / 1000.0)) / (1 << 20) << " MB/s)\n";
+}
+
+int main() {
+    std::cout << "\n--- Large Value GET Reply Benchmarks (serialize + sendmsg to a socketpair) ---\n\n";
+    for (size_t size : VALUE_SIZES) {
+        run_benchmark(size, false, std::cout);
+        run_benchmark(size, true, std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../logging.hpp"
+
+// Cost per log call on the calling thread: a level compiled out, a level disabled at runtime, the async logger
+// enabled (the writer thread drains to /dev/null, a full ring drops), and the synchronous std::cerr it replaced.
+
+constexpr size_t NUM_OPS = 1'000'000;
+
+template<typename F>
+void run_benchmark(const char* label, F&& body, std::ostream& report) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        body(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    report << "[" << label << "] " << NUM_OPS << " ops in " << elapsed_ms << " ms ("
+           << (NUM_OPS / (elapsed_ms / 1000.0)) << " ops/sec, " << (elapsed_ms * 1e6 / NUM_OPS) << " ns/op)\n";
+}
+
+int main() {
+    int saved_stderr = dup(STDERR_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDERR_FILENO);
+
+    std::cout << "\n--- Logging Benchmarks (per call, output to /dev/null) ---\n\n";
+    std::string key = "user:12345";
+
+    run_benchmark("trace, compiled out", [&](size_t i) { LOG_TRACE("Received command: GET {} #{}", key, i); }, std::cout);
+
+    Logger::instance().set_level(LogLevel::Error);
+    run_benchmark("info, disabled at runtime", [&](size_t i) { LOG_INFO("Received command: GET {} #{}", key, i); }, std::cout);
+
+    Logger::instance().set_level(LogLevel::Info);
+    size_t dropped_before = Logger::instance().dropped();
+    run_benchmark("info, async", [&](size_t i) { LOG_INFO("Received command: GET {} #{}", key, i); }, std::cout);
+    std::cout << "  (" << Logger::instance().dropped() - dropped_before << " dropped on a full ring)\n";
+    Logger::instance().flush();
+
+    run_benchmark("std::cerr, synchronous", [&](size_t i) {
+        std::cerr << " Received command: GET " << key << " #" << i << std::endl;
+    }, std::cout);
+
+    dup2(saved_stderr, STDERR_FILENO);
+    close(devnull);
+    close(saved_stderr);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include "../command_processor.hpp"
+#include "../request_parser.hpp"
+
+// Parses and executes the same binary GET frame ITERATIONS times, once through the copying parser
+// (std::vector<std::string>) and once through parse_views, counting heap allocations per request.
+
+constexpr size_t ITERATIONS = 1000000;
+
+static size_t allocation_count = 0;
+
+static void* counted_alloc(size_t size, size_t alignment) {
+    ++allocation_count;
+    size = size ? size : 1;
+    void* ptr = alignment > alignof(std::max_align_t)
+                    ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                    : std::malloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+// The deletes stay out of line: inlined, GCC sees free() on what a new-expression returned (-Wmismatched-new-delete).
+void* operator new(size_t size) { return counted_alloc(size, 0); }
+void* operator new[](size_t size) { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+std::vector<uint8_t> make_frame(const std::vector<std::string>& args) {
+    std::vector<uint8_t> body;
+    for (const auto& arg : args) {
+        uint32_t len = __builtin_bswap32(static_cast<uint32_t>(arg.size()));
+        ResponseSerializer::append_data(body, len);
+        body.insert(body.end(), arg.begin(), arg.end());
+    }
+    std::vector<uint8_t> frame;
+    ResponseSerializer::append_data(frame, __builtin_bswap32(static_cast<uint32_t>(body.size())));
+    frame.insert(frame.end(), body.begin(), body.end());
+    return frame;
+}
+
+template<typename Fn>
+void run_benchmark(const char* label, Fn&& fn) {
+    size_t allocations_before = allocation_count;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        fn();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    double per_request = static_cast<double>(allocation_count - allocations_before) / ITERATIONS;
+
+    std::cout << "[" << label << "] " << ITERATIONS << " ops in " << elapsed_ms << " ms ("
+           << (ITERATIONS / (elapsed_ms / 1000.0)) << " ops/sec, " << per_request << " allocs/request)\n";
+}
+
+int main() {
+    EntryManager entry_manager;
+    const std::string key = "user:profile:00000042";  // longer than the SSO buffer on purpose
+    entry_manager.create_entry(key, Value::string(std::string(512, 'v')));
+
+    auto frame = make_frame({"GET", key});
+    std::vector<uint8_t> response;
+    response.reserve(1024);
+
+    std::cout << "\n--- Request Parsing Benchmarks (binary GET frame, hit) ---\n\n";
+
+    run_benchmark("parse (copying)", [&] {
+        auto args = RequestParser::parse(frame);
+        response.clear();
+        CommandArgs views;
+        for (const auto& arg : *args) {
+            views.push_back(arg);
+        }
+        CommandProcessor::process_command({views, response, entry_manager});
+    });
+
+    run_benchmark("parse_views", [&] {
+        auto args = RequestParser::parse_views(frame);
+        response.clear();
+        CommandProcessor::process_command({*args, response, entry_manager});
+    });
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../reactor.hpp"
+
+// One client, TOTAL_COMMANDS GETs sent in bursts of DEPTH: every burst is one write, one epoll wakeup and
+// (with batched flushing) one reply write, so ops/sec should scale with depth until parsing dominates.
+
+constexpr size_t TOTAL_COMMANDS = 100000;
+constexpr size_t DEPTHS[] = {1, 10, 100};
+
+void run_benchmark(size_t depth, std::ostream& report) {
+    EntryManager entry_manager;
+    CommandProcessor command_processor;
+    std::atomic<bool> should_stop{false};
+    Reactor reactor(0, IoBackend::Epoll, false, entry_manager, command_processor, should_stop);
+    if (!reactor.initialize()) {
+        std::cerr << "initialize failed\n";
+        return;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        std::cerr << "socketpair failed\n";
+        return;
+    }
+    Socket server_side(fds[0]);
+    (void)server_side.set_nonblocking();
+    reactor.add_connection(std::make_unique<Connection>(std::move(server_side), entry_manager, command_processor));
+    int client = fds[1];
+
+    std::string burst;
+    for (size_t i = 0; i < depth; ++i) {
+        burst += "GET bench_key\n";
+    }
+    const size_t reply_size = 1;  // a miss is a single Nil byte
+    std::vector<char> reply(depth * reply_size);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t sent = 0; sent < TOTAL_COMMANDS; sent += depth) {
+        (void)write(client, burst.data(), burst.size());
+        reactor.epoll_once(0);
+
+        size_t got = 0;
+        while (got < reply.size()) {
+            ssize_t n = read(client, reply.data() + got, reply.size() - got);
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    report << "[Pipeline depth " << depth << "] " << TOTAL_COMMANDS << " ops in " << elapsed_ms
+           << " ms (" << (TOTAL_COMMANDS / (elapsed_ms / 1000.0)) << " ops/sec)\n";
+
+    close(client);
+}
+
+int main() {
+    // the server logs every command, silence it so we only time the loop
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    std::streambuf* err = std::cerr.rdbuf(nullptr);
+    std::ostream report(out);
+
+    report << "\n--- Pipelining Benchmarks (GET, single connection, epoll) ---\n\n";
+    for (size_t depth : DEPTHS) {
+        run_benchmark(depth, report);
+    }
+
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "../reactor.hpp"
+
+// Compares one wakeup of the poll loop (pollfd rebuild + hash lookup per fd) against the
+// edge-triggered epoll loop and the io_uring loop, with a single active client among N idle keep-alive connections.
+
+constexpr int WAKEUPS = 2000;
+constexpr size_t CONNECTION_COUNTS[] = {100, 1000, 10000};
+
+void raise_fd_limit(size_t needed) {
+    rlimit lim{};
+    getrlimit(RLIMIT_NOFILE, &lim);
+    if (lim.rlim_cur < needed) {
+        lim.rlim_cur = std::min<rlim_t>(needed, lim.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+void run_benchmark(IoBackend backend, size_t num_connections, std::ostream& report) {
+    EntryManager entry_manager;
+    CommandProcessor command_processor;
+    std::atomic<bool> should_stop{false};
+    ConnectionLimits limits;
+    limits.idle_timeout = std::chrono::hours(1);  // the slow poll runs must not have their connections reaped
+    Reactor reactor(0, backend, false, entry_manager, command_processor, should_stop, limits);
+    auto init = reactor.initialize();
+    if (!init) {
+        std::cerr << "initialize failed: " << init.error().message() << "\n";
+        return;
+    }
+
+    std::vector<int> clients;
+    clients.reserve(num_connections);
+    for (size_t i = 0; i < num_connections; ++i) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            std::cerr << "socketpair failed after " << i << " connections: " << strerror(errno) << "\n";
+            break;
+        }
+        Socket server_side(fds[0]);
+        (void)server_side.set_nonblocking();
+        reactor.add_connection(std::make_unique<Connection>(
+            std::move(server_side), entry_manager, command_processor));
+        clients.push_back(fds[1]);
+    }
+
+    const char request[] = "GET bench_key\n";
+    char reply[256];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < WAKEUPS; ++i) {
+        int client = clients[i % clients.size()];
+        (void)write(client, request, sizeof(request) - 1);
+
+        switch (backend) {
+            case IoBackend::Epoll: reactor.epoll_once(0); break;
+            case IoBackend::Uring:
+                // sends queued by this pass go out with the next io_uring_enter, so keep turning the loop
+                do {
+                    reactor.uring_once(0);
+                } while (recv(client, reply, sizeof(reply), MSG_PEEK | MSG_DONTWAIT) <= 0);
+                break;
+            default:               reactor.poll_once(0); break;
+        }
+
+        (void)read(client, reply, sizeof(reply));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    const char* label = backend == IoBackend::Epoll ? "epoll" : backend == IoBackend::Uring ? "uring" : "poll ";
+    report << "[" << label << "] "
+           << clients.size() << " connections: " << WAKEUPS << " wakeups in "
+           << elapsed_ms << " ms (" << (elapsed_ms * 1000.0 / WAKEUPS) << " us/wakeup)\n";
+
+    for (int fd : clients) {
+        close(fd);
+    }
+}
+
+int main() {
+    raise_fd_limit(2 * CONNECTION_COUNTS[std::size(CONNECTION_COUNTS) - 1] + 64);
+
+    // the server logs every command, silence it so we only time the loop
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    std::streambuf* err = std::cerr.rdbuf(nullptr);
+    std::ostream report(out);
+
+    report << "\n--- Event Loop Wakeup Benchmarks (1 active client, N-1 idle) ---\n\n";
+
+    for (size_t n : CONNECTION_COUNTS) {
+        for (IoBackend backend : {IoBackend::Poll, IoBackend::Epoll, IoBackend::Uring}) {
+            run_benchmark(backend, n, report);
+        }
+    }
+
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+    return 0;
+}
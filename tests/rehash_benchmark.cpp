@@ -0,0 +1,77 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/hashtable.hpp"
+
+// Per-insert latency while an HMap grows from empty to N keys (through every doubling), then per-remove latency
+// while it's emptied again. Two setups: RehashMode::Foreground, where every insert and remove moves a bounded
+// step and removes start the shrinks. And RehashMode::Background with a thread calling rehash like EntryManager's
+// rehash cycle does (REHASH_BUSY_BUDGET every millisecond), where inserts only help under pressure. The tail
+// percentiles are the point - a resize shouldn't show up in any single operation.
+// Pass key counts to try other sizes, e.g. ./rehash_benchmark 1000000 10000000.
+
+static void report(const char* label, std::vector<uint64_t>& ns) {
+    std::sort(ns.begin(), ns.end());
+    auto at = [&](double p) { return ns[std::min(ns.size() - 1, static_cast<size_t>(p * ns.size()))]; };
+    std::cout << "[" << label << "] p50 " << at(0.5) << " ns, p99 " << at(0.99) << " ns, p99.9 " << at(0.999)
+              << " ns, p99.99 " << at(0.9999) << " ns, max " << ns.back() << " ns\n";
+}
+
+static void run_benchmark(size_t num_keys, bool background) {
+    HMap<uint64_t, uint64_t> map(background ? RehashMode::Background : RehashMode::Foreground);
+    std::atomic<bool> done{false};
+    std::thread driver;
+    if (background) {
+        driver = std::thread([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                map.rehash(std::chrono::steady_clock::now() + std::chrono::microseconds(100));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    std::vector<uint64_t> ns(num_keys);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        map.insert(i, i);
+        ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::string label = std::to_string(num_keys) + " inserts, " + (background ? "background rehash" : "foreground steps");
+    report(label.c_str(), ns);
+
+    size_t before = map.capacity();
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        map.remove(i);
+        ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    label = std::to_string(num_keys) + " removes, " + (background ? "background rehash" : "foreground steps");
+    report(label.c_str(), ns);
+    std::cout << "    capacity " << before << " -> " << map.capacity() << " after emptying\n";
+
+    done = true;
+    if (driver.joinable()) driver.join();
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::stoull(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {1'000'000};
+    }
+
+    std::cout << "\n--- HMap Resize Latency Benchmarks ---\n\n";
+    for (size_t num_keys : sizes) {
+        run_benchmark(num_keys, false);
+        run_benchmark(num_keys, true);
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../command_processor.hpp"
+
+// SET/GET throughput through CommandProcessor from 1 to N threads (default: hardware threads), against one
+// keyspace shard (every command on the same lock, like the old single keyspace lock) and against the sharded
+// keyspace the server builds (EntryManager::shards_for). 1 in 4 commands is a SET.
+// Pass the key count and thread count to change them, e.g. ./shard_benchmark 1000000 32.
+
+constexpr size_t OPS_PER_THREAD = 500'000;
+
+static double run(EntryManager& entry_manager, const std::vector<std::string>& keys, size_t threads) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<uint8_t> response;
+            response.reserve(64);
+            while (!go.load(std::memory_order_acquire)) {}
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                const std::string& key = keys[(i * 7919 + t * 104729) % keys.size()];
+                CommandArgs args;
+                if (i % 4 == 0) {
+                    args.push_back("SET");
+                    args.push_back(key);
+                    args.push_back("value");
+                } else {
+                    args.push_back("GET");
+                    args.push_back(key);
+                }
+                response.clear();
+                CommandProcessor::process_command({args, response, entry_manager});
+            }
+        });
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    return threads * OPS_PER_THREAD / elapsed;
+}
+
+int main(int argc, char** argv) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    size_t max_threads = argc > 2 ? std::stoull(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::string> keys;
+    keys.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        keys.push_back("user:" + std::to_string(i));
+    }
+
+    std::cout << "\n--- Sharded Keyspace Benchmarks (" << num_keys << " keys, 25% SET) ---\n\n";
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        for (size_t shards : {size_t{1}, EntryManager::shards_for(max_threads)}) {
+            EntryManager entry_manager(1, shards);
+            {
+                auto locks = entry_manager.lock_all(true);
+                for (const auto& key : keys) entry_manager.create_entry(key, Value::string(std::string_view("value")));
+            }
+            double ops = run(entry_manager, keys, threads);
+            std::cout << "[" << threads << " threads, " << entry_manager.shard_count() << " shard(s)] " << ops / 1e6
+                      << " M ops/sec\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/heap.hpp"
+#include "../src/hierarchical_wheel.hpp"
+
+// Key TTL bookkeeping at session-cache scale: the position-tracking BinaryHeap EntryManager used to keep deadlines
+// in, against the HierarchicalWheel that replaced it. Each run schedules N deadlines up to 10 minutes out,
+// reschedules all of them (PEXPIRE again), cancels half (DEL) and expires the rest.
+// Pass the key count to try a bigger set, e.g. ./ttl_benchmark 10000000.
+
+constexpr uint64_t TTL_RANGE_MS = 600'000;
+
+struct TtlItem {
+    uint64_t deadline = 0;
+    size_t heap_idx = static_cast<size_t>(-1);
+    HierarchicalWheel<TtlItem>::Node node{this};
+};
+
+template<typename F>
+void run_benchmark(const std::string& label, size_t ops, F&& body) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t done = body();
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "[" << label << "] " << ops << " ops in " << elapsed_ms << " ms ("
+              << (ops / (elapsed_ms / 1000.0)) << " ops/sec, " << done << " done)\n";
+}
+
+int main(int argc, char** argv) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> first(num_keys), second(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        first[i] = 1 + rng() % TTL_RANGE_MS;
+        second[i] = 1 + rng() % TTL_RANGE_MS;
+    }
+
+    std::cout << "\n--- TTL Benchmarks (" << num_keys << " keys) ---\n\n";
+    {
+        auto items = std::make_unique<TtlItem[]>(num_keys);
+        BinaryHeap<uint64_t> heap(std::less<uint64_t>{});
+        run_benchmark("BinaryHeap, schedule", num_keys, [&] {
+            for (size_t i = 0; i < num_keys; ++i) {
+                heap.push(HeapItem<uint64_t>(first[i], &items[i].heap_idx));
+            }
+            return heap.size();
+        });
+        run_benchmark("BinaryHeap, reschedule", num_keys, [&] {
+            for (size_t i = 0; i < num_keys; ++i) {
+                heap[items[i].heap_idx].set_value(second[i]);
+                heap.update(items[i].heap_idx);
+            }
+            return num_keys;
+        });
+        run_benchmark("BinaryHeap, cancel", num_keys / 2, [&] {
+            for (size_t i = 0; i < num_keys; i += 2) {
+                heap.erase(items[i].heap_idx);
+            }
+            return num_keys - heap.size();
+        });
+        run_benchmark("BinaryHeap, expire", num_keys - num_keys / 2, [&] {
+            size_t expired = 0;
+            while (!heap.empty()) {
+                heap.pop();
+                expired++;
+            }
+            return expired;
+        });
+    }
+    {
+        auto items = std::make_unique<TtlItem[]>(num_keys);
+        HierarchicalWheel<TtlItem> wheel(0);
+        run_benchmark("HierarchicalWheel, schedule", num_keys, [&] {
+            for (size_t i = 0; i < num_keys; ++i) {
+                wheel.schedule(items[i].node, first[i]);
+            }
+            return wheel.size();
+        });
+        run_benchmark("HierarchicalWheel, reschedule", num_keys, [&] {
+            for (size_t i = 0; i < num_keys; ++i) {
+                wheel.schedule(items[i].node, second[i]);
+            }
+            return num_keys;
+        });
+        run_benchmark("HierarchicalWheel, cancel", num_keys / 2, [&] {
+            for (size_t i = 0; i < num_keys; i += 2) {
+                wheel.cancel(items[i].node);
+            }
+            return num_keys - wheel.size();
+        });
+        run_benchmark("HierarchicalWheel, expire", num_keys - num_keys / 2, [&] {
+            return wheel.advance(TTL_RANGE_MS, SIZE_MAX, [](TtlItem&) {});
+        });
+    }
+    return 0;
+}
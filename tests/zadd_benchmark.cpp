@@ -0,0 +1,89 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cmath>
+#include "../command_processor.hpp"
+#include "../arg_parser.hpp"
+
+// Bulk ZADD ingestion: the score parse on its own (the old std::stod + try/catch against ArgParser's from_chars,
+// for well-formed and malformed scores) and end to end through CommandProcessor into one sorted set.
+
+constexpr size_t NUM_SCORES = 1'000'000;
+constexpr size_t NUM_ZADDS = 200'000;
+
+static bool stod_parse_double(std::string_view view, double& out) {
+    std::string str(view);
+    try {
+        size_t pos;
+        out = std::stod(str, &pos);
+        return pos == str.size() && !std::isnan(out);
+    } catch (const std::invalid_argument&) {
+        return false;
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+}
+
+template<typename F>
+void run_benchmark(const char* label, size_t ops, F&& body) {
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t ok = body();
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "[" << label << "] " << ops << " ops in " << elapsed_ms << " ms ("
+              << (ops / (elapsed_ms / 1000.0)) << " ops/sec, " << ok << " ok)\n";
+}
+
+int main() {
+    std::vector<std::string> scores, malformed;
+    for (size_t i = 0; i < NUM_SCORES; ++i) {
+        scores.push_back(std::to_string(i * 0.37 - 1000.0));
+        malformed.push_back("score:" + std::to_string(i));  // stod throws on these
+    }
+
+    std::cout << "\n--- Score Parsing Benchmarks ---\n\n";
+    for (auto* input : {&scores, &malformed}) {
+        const char* kind = input == &scores ? "well-formed" : "malformed";
+        std::cout << kind << ":\n";
+        run_benchmark("stod + try/catch", NUM_SCORES, [&] {
+            size_t ok = 0;
+            double score;
+            for (const auto& s : *input) ok += stod_parse_double(s, score);
+            return ok;
+        });
+        run_benchmark("ArgParser (from_chars)", NUM_SCORES, [&] {
+            size_t ok = 0;
+            double score;
+            for (const auto& s : *input) ok += ArgParser::parse_double(s, score);
+            return ok;
+        });
+    }
+
+    std::cout << "\n--- Bulk ZADD Ingestion (one sorted set) ---\n\n";
+    EntryManager entry_manager;
+    std::vector<std::string> members;
+    for (size_t i = 0; i < NUM_ZADDS; ++i) {
+        members.push_back("member:" + std::to_string(i));
+    }
+    std::vector<uint8_t> response;
+    response.reserve(64);
+
+    run_benchmark("ZADD key score member", NUM_ZADDS, [&] {
+        size_t ok = 0;
+        for (size_t i = 0; i < NUM_ZADDS; ++i) {
+            CommandArgs args;
+            args.push_back("ZADD");
+            args.push_back("leaderboard");
+            args.push_back(scores[i]);
+            args.push_back(members[i]);
+            response.clear();
+            CommandProcessor::process_command({args, response, entry_manager});
+            ok += response[0] == static_cast<uint8_t>(SerializationType::Integer);
+        }
+        return ok;
+    });
+    return 0;
+}
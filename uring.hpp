@@ -0,0 +1,351 @@
+#ifndef URING_HPP
+#define URING_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <memory>
+#include <vector>
+#include <span>
+#include <atomic>
+#include <expected>
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <poll.h>
+#include "socket.hpp"
+
+template<typename T>
+using Result = std::expected<T, std::error_code>;
+
+// Minimal io_uring driver on raw syscalls (no liburing dependency).
+//
+// One ring per reactor. SQEs are queued with the prep_* helpers and all of them go to the kernel in the
+// single io_uring_enter made by submit_and_wait, together with the wait for completions - so one syscall
+// services every connection that became ready since the last loop iteration. Receives use a provided
+// buffer ring (IORING_REGISTER_PBUF_RING) so a multishot recv can stay armed without a buffer per connection.
+//
+// Needs a 6.0+ kernel. create() checks the SINGLE_MMAP/NODROP/EXT_ARG feature bits, registers the PBUF_RING
+// and then probes a multishot recv on a socketpair - 5.19 has everything else but rejects IORING_RECV_MULTISHOT
+// with -EINVAL. Any of these failing makes create() return an error and the reactor falls back to epoll.
+
+enum class UringOp : uint64_t {
+    Wakeup = 0,  // the offload eventfd, see Offloader
+    Accept = 1,
+    Recv   = 2,
+    Send   = 3
+};
+
+// user_data packs the owner pointer (8-byte aligned) with the op in the low bits
+inline uint64_t encode_user_data(const void* ptr, UringOp op) noexcept {
+    return reinterpret_cast<uint64_t>(ptr) | static_cast<uint64_t>(op);
+}
+
+inline UringOp decode_op(uint64_t user_data) noexcept {
+    return static_cast<UringOp>(user_data & 0x3);
+}
+
+template<typename T>
+inline T* decode_ptr(uint64_t user_data) noexcept {
+    return reinterpret_cast<T*>(user_data & ~uint64_t{0x3});
+}
+
+class IoUring {
+public:
+    static constexpr uint16_t BUFFER_GROUP = 0;
+
+    ~IoUring() {
+        ring_fd_ = Socket(-1);  // tear the ring down first so the kernel stops writing into buffers_
+        if (buf_ring_) munmap(buf_ring_, buf_ring_size_);
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) munmap(sq_ptr_, sq_size_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // entries is the SQ depth, buffer_count (power of two) x buffer_size bytes back the multishot receives
+    static Result<std::unique_ptr<IoUring>> create(unsigned entries, unsigned buffer_count, unsigned buffer_size) {
+        std::unique_ptr<IoUring> ring(new IoUring());
+
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;  // multishot ops post many CQEs per SQE
+
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        ring->ring_fd_ = Socket(fd);
+
+        constexpr unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((params.features & required) != required) {
+            return std::unexpected(std::make_error_code(std::errc::function_not_supported));
+        }
+
+        auto mapped = ring->map_rings(params);
+        if (!mapped) {
+            return std::unexpected(mapped.error());
+        }
+
+        auto buffers = ring->register_buffer_ring(buffer_count, buffer_size);
+        if (!buffers) {
+            return std::unexpected(buffers.error());
+        }
+
+        auto multishot = ring->probe_multishot_recv();
+        if (!multishot) {
+            return std::unexpected(multishot.error());
+        }
+
+        return ring;
+    }
+
+    void prep_multishot_accept(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->user_data = user_data;
+    }
+
+    // the kernel picks a buffer from BUFFER_GROUP per completion, its id comes back in cqe.flags
+    void prep_multishot_recv(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = user_data;
+    }
+
+    // msg and the iovecs it points at must stay put until the completion arrives
+    void prep_sendmsg(int fd, const msghdr* msg, uint64_t user_data) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = user_data;
+    }
+
+    // a completion every time fd turns readable, stays armed while cqe.flags has IORING_CQE_F_MORE
+    void prep_multishot_poll(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = user_data;
+    }
+
+    // submits everything queued and waits for at least one completion or the timeout (-1 = forever)
+    Result<void> submit_and_wait(int timeout_ms) {
+        unsigned to_submit = pending_submissions();
+        std::atomic_ref<unsigned>(*sq_tail_).store(sq_local_tail_, std::memory_order_release);
+
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        unsigned flags = IORING_ENTER_GETEVENTS;
+        const void* argp = nullptr;
+        size_t argsz = 0;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1'000'000;
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_.get(), to_submit, 1u, flags, argp, argsz));
+        if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        return {};
+    }
+
+    // hands every available CQE to f and releases them back to the kernel in one store
+    template<typename F>
+    unsigned for_each_cqe(F&& f) {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        unsigned seen = 0;
+        for (; head != tail; ++head, ++seen) {
+            f(cqes_[head & cq_mask_]);
+        }
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        return seen;
+    }
+
+    [[nodiscard]] std::span<const uint8_t> buffer(uint16_t bid, size_t len) const noexcept {
+        return {buffers_.data() + static_cast<size_t>(bid) * buffer_size_, len};
+    }
+
+    // gives a provided buffer back to the kernel once its bytes have been consumed
+    void recycle_buffer(uint16_t bid) noexcept {
+        // index the ring as a plain io_uring_buf array: under C++ the header's __DECLARE_FLEX_ARRAY puts
+        // bufs behind an empty struct, which shifts it 8 bytes away from where the kernel reads it
+        auto* bufs = reinterpret_cast<io_uring_buf*>(buf_ring_);
+        unsigned short tail = buf_ring_->tail;
+        io_uring_buf& slot = bufs[tail & buf_mask_];
+        slot.addr = reinterpret_cast<uint64_t>(buffers_.data() + static_cast<size_t>(bid) * buffer_size_);
+        slot.len = buffer_size_;
+        slot.bid = bid;
+        std::atomic_ref<unsigned short>(buf_ring_->tail).store(static_cast<unsigned short>(tail + 1), std::memory_order_release);
+    }
+
+    [[nodiscard]] int fd() const noexcept { return ring_fd_.get(); }
+
+private:
+    IoUring() = default;
+
+    Socket ring_fd_{-1};
+
+    void* sq_ptr_{nullptr};
+    void* cq_ptr_{nullptr};
+    size_t sq_size_{0};
+    size_t cq_size_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_size_{0};
+
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    unsigned sq_local_tail_{0};
+
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+    unsigned cq_mask_{0};
+
+    io_uring_buf_ring* buf_ring_{nullptr};
+    size_t buf_ring_size_{0};
+    unsigned buf_mask_{0};
+    unsigned buffer_size_{0};
+    std::vector<uint8_t> buffers_;
+
+    [[nodiscard]] unsigned pending_submissions() const noexcept {
+        return sq_local_tail_ - std::atomic_ref<unsigned>(*sq_tail_).load(std::memory_order_relaxed);
+    }
+
+    Result<void> map_rings(const io_uring_params& p) {
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);  // FEAT_SINGLE_MMAP: one mapping covers both
+
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_.get(), IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        cq_ptr_ = sq_ptr_;
+
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_.get(), IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<uint8_t*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+        sq_local_tail_ = *sq_tail_;
+
+        auto* cq = static_cast<uint8_t*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return {};
+    }
+
+    Result<void> register_buffer_ring(unsigned count, unsigned size) {
+        buf_ring_size_ = count * sizeof(io_uring_buf);
+        void* mem = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        buf_ring_ = static_cast<io_uring_buf_ring*>(mem);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = count;
+        reg.bgid = BUFFER_GROUP;
+        if (syscall(__NR_io_uring_register, ring_fd_.get(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+
+        buf_mask_ = count - 1;
+        buffer_size_ = size;
+        buffers_.resize(static_cast<size_t>(count) * size);
+        for (unsigned bid = 0; bid < count; ++bid) {
+            recycle_buffer(static_cast<uint16_t>(bid));
+        }
+        return {};
+    }
+
+    // arms a multishot recv on a socketpair whose read side is already shut down: a kernel that knows
+    // IORING_RECV_MULTISHOT completes it at once with EOF (res 0), an older one rejects it with -EINVAL
+    Result<void> probe_multishot_recv() {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+            return std::unexpected(std::make_error_code(static_cast<std::errc>(errno)));
+        }
+        Socket local(fds[0]);
+        Socket peer(fds[1]);
+        shutdown(local.get(), SHUT_RD);
+
+        prep_multishot_recv(local.get(), 0);
+        auto submitted = submit_and_wait(1000);
+        if (!submitted) {
+            return std::unexpected(submitted.error());
+        }
+
+        bool completed = false;
+        int res = 0;
+        for_each_cqe([&](const io_uring_cqe& cqe) {
+            completed = true;
+            res = cqe.res;
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                recycle_buffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        });
+        if (!completed || res < 0) {
+            return std::unexpected(std::make_error_code(std::errc::function_not_supported));
+        }
+        return {};
+    }
+
+    // flushes the SQ to the kernel when it is full so callers never have to handle a null SQE
+    io_uring_sqe* get_sqe() {
+        while (sq_local_tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) >= sq_entries_) {
+            unsigned to_submit = pending_submissions();
+            std::atomic_ref<unsigned>(*sq_tail_).store(sq_local_tail_, std::memory_order_release);
+            syscall(__NR_io_uring_enter, ring_fd_.get(), to_submit, 0u, 0u, nullptr, 0);
+        }
+        unsigned idx = sq_local_tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[idx] = idx;
+        ++sq_local_tail_;
+        return sqe;
+    }
+};
+
+#endif // URING_HPP
@@ -0,0 +1,219 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "src/zset.hpp"
+
+enum class ValueType : uint8_t {
+    String,
+    ZSet
+};
+
+// How a value's payload is stored. A String is Embedded (up to EMBED_MAX bytes inside the Value), Int (a canonical
+// decimal integer kept as an int64) or Raw (a heap string behind a shared_ptr, so a large GET can pin it for a
+// zero-copy reply instead of copying it). A ZSet is an owned Object.
+enum class ValueEncoding : uint8_t {
+    Embedded,
+    Int,
+    Raw,
+    Object
+};
+
+// What the keyspace stores per key, inline in the hash node: an 8 byte header (type and encoding tag, flags,
+// embedded length, LRU clock) and a 16 byte payload. No vtable, no separate heap object and no second copy of the
+// key - the node has that - and the type check on GET/ZADD is a tag compare instead of a dynamic_pointer_cast.
+// Move only, a Value owns its payload.
+class Value {
+public:
+    static constexpr size_t EMBED_MAX = 16;
+    static constexpr size_t INT_DIGITS_MAX = 20;  // "-9223372036854775808"
+
+    static constexpr uint8_t FLAG_TTL = 1 << 0;   // the key has an entry in EntryManager's expiry table
+
+    Value() noexcept : Value(ValueType::String, ValueEncoding::Embedded) {}
+
+    static Value string(std::string_view bytes) {
+        if (auto value = try_int(bytes)) return std::move(*value);
+        if (bytes.size() <= EMBED_MAX) return embedded(bytes);
+        return raw(std::make_shared<const std::string>(bytes));
+    }
+
+    // a value already in its own std::string (a streamed SET) is moved, not copied, if it ends up Raw
+    static Value string(std::string&& bytes) {
+        if (auto value = try_int(bytes)) return std::move(*value);
+        if (bytes.size() <= EMBED_MAX) return embedded(bytes);
+        return raw(std::make_shared<const std::string>(std::move(bytes)));
+    }
+
+    static Value zset(std::unique_ptr<ZSet> set) {
+        Value value(ValueType::ZSet, ValueEncoding::Object);
+        value.payload_.object = set.release();
+        return value;
+    }
+
+    ~Value() { reset(); }
+
+    Value(Value&& other) noexcept : header_(other.header_) {
+        take(other);
+    }
+
+    // self-move safe with no this != &other branch (GCC then thinks create_entry may return its by-value argument)
+    Value& operator=(Value&& other) noexcept {
+        Value moved(std::move(other));
+        reset();
+        header_ = moved.header_;
+        take(moved);
+        return *this;
+    }
+
+    Value(const Value&) = delete;
+    Value& operator=(const Value&) = delete;
+
+    [[nodiscard]] ValueType type() const noexcept { return header_.type; }
+    [[nodiscard]] ValueEncoding encoding() const noexcept { return header_.encoding; }
+    [[nodiscard]] bool is_string() const noexcept { return header_.type == ValueType::String; }
+    [[nodiscard]] bool is_zset() const noexcept { return header_.type == ValueType::ZSet; }
+
+    // The string's bytes. An Int is formatted into scratch, the other encodings point into the Value (or its
+    // Raw string) and stay valid while the Value is neither changed nor destroyed.
+    [[nodiscard]] std::string_view str(char (&scratch)[INT_DIGITS_MAX]) const noexcept {
+        switch (header_.encoding) {
+            case ValueEncoding::Int:
+                return {scratch, static_cast<size_t>(std::to_chars(scratch, scratch + INT_DIGITS_MAX, payload_.integer).ptr - scratch)};
+            case ValueEncoding::Embedded:
+                return {payload_.embedded, header_.length};
+            case ValueEncoding::Raw:
+                return *payload_.raw;
+            default:
+                return {};
+        }
+    }
+
+    // Raw only: the owner to pin for a zero-copy reply (see ValueRef). Copying it is the one refcount touch, so
+    // callers only ask for it once a value is big enough to be sent by reference.
+    [[nodiscard]] const std::shared_ptr<const std::string>& raw_string() const noexcept { return payload_.raw; }
+
+    [[nodiscard]] ZSet* zset() const noexcept { return is_zset() ? payload_.object : nullptr; }
+
+    // heap bytes owned outside the Value itself, for EntryManager's memory accounting: a Raw string's block
+    // (make_shared puts the control block and the string together) or a ZSet and its members
+    [[nodiscard]] size_t memory_usage() const noexcept {
+        switch (header_.encoding) {
+            case ValueEncoding::Raw:
+                return sizeof(std::string) + 2 * sizeof(long) + string_heap_bytes(payload_.raw->size());
+            case ValueEncoding::Object:
+                return sizeof(ZSet) + payload_.object->memory_usage();
+            default:
+                return 0;
+        }
+    }
+
+    [[nodiscard]] bool has_ttl() const noexcept { return header_.flags & FLAG_TTL; }
+    void set_ttl_flag(bool on) noexcept {
+        header_.flags = on ? (header_.flags | FLAG_TTL) : (header_.flags & ~FLAG_TTL);
+    }
+
+    // Access word for eviction: the coarse LRU clock of the last access, or under LFU a decaying access counter
+    // (EntryManager picks, see EvictionPolicy). Written under the keyspace's shared lock by concurrent readers -
+    // relaxed atomic stores, and only when the word actually changed so a hot key's cache line isn't dirtied on
+    // every GET.
+    [[nodiscard]] uint32_t lru() const noexcept {
+        return std::atomic_ref<uint32_t>(const_cast<uint32_t&>(header_.lru)).load(std::memory_order_relaxed);
+    }
+    void touch(uint32_t clock) noexcept {
+        std::atomic_ref<uint32_t> lru(header_.lru);
+        if (lru.load(std::memory_order_relaxed) != clock) {
+            lru.store(clock, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Header {
+        ValueType type;
+        ValueEncoding encoding;
+        uint8_t flags;
+        uint8_t length;  // Embedded only
+        uint32_t lru;
+    };
+
+    union Payload {
+        Payload() noexcept : integer(0) {}
+        ~Payload() {}
+
+        char embedded[EMBED_MAX];
+        int64_t integer;
+        std::shared_ptr<const std::string> raw;
+        ZSet* object;
+    };
+
+    Header header_;
+    Payload payload_;
+
+    Value(ValueType type, ValueEncoding encoding) noexcept : header_{type, encoding, 0, 0, 0} {}
+
+    static Value embedded(std::string_view bytes) noexcept {
+        Value value(ValueType::String, ValueEncoding::Embedded);
+        std::memcpy(value.payload_.embedded, bytes.data(), bytes.size());
+        value.header_.length = static_cast<uint8_t>(bytes.size());
+        return value;
+    }
+
+    static Value raw(std::shared_ptr<const std::string> bytes) noexcept {
+        Value value(ValueType::String, ValueEncoding::Raw);
+        new (&value.payload_.raw) std::shared_ptr<const std::string>(std::move(bytes));
+        return value;
+    }
+
+    // only when formatting the int back gives exactly these bytes, so GET returns what SET stored
+    static std::optional<Value> try_int(std::string_view bytes) noexcept {
+        if (bytes.empty() || bytes.size() > INT_DIGITS_MAX) return std::nullopt;
+        if (bytes[0] == '0' && bytes.size() > 1) return std::nullopt;
+        if (bytes[0] == '-' && (bytes.size() == 1 || bytes[1] == '0')) return std::nullopt;
+
+        int64_t integer;
+        auto [end, ec] = std::from_chars(bytes.data(), bytes.data() + bytes.size(), integer);
+        if (ec != std::errc() || end != bytes.data() + bytes.size()) return std::nullopt;
+
+        Value value(ValueType::String, ValueEncoding::Int);
+        value.payload_.integer = integer;
+        return value;
+    }
+
+    void take(Value& other) noexcept {
+        switch (header_.encoding) {
+            case ValueEncoding::Raw:
+                new (&payload_.raw) std::shared_ptr<const std::string>(std::move(other.payload_.raw));
+                other.payload_.raw.~shared_ptr();
+                break;
+            case ValueEncoding::Object:
+                payload_.object = other.payload_.object;
+                break;
+            default:
+                std::memcpy(payload_.embedded, other.payload_.embedded, EMBED_MAX);
+                break;
+        }
+        other.header_ = Header{ValueType::String, ValueEncoding::Embedded, 0, 0, 0};
+    }
+
+    void reset() noexcept {
+        if (header_.encoding == ValueEncoding::Raw) {
+            payload_.raw.~shared_ptr();
+        } else if (header_.encoding == ValueEncoding::Object) {
+            delete payload_.object;
+        }
+        header_ = Header{ValueType::String, ValueEncoding::Embedded, 0, 0, 0};
+    }
+};
+
+static_assert(sizeof(Value) == 24, "Value is meant to stay at an 8 byte header + 16 byte payload");
+
+#endif // VALUE_HPP